@@ -0,0 +1,41 @@
+#ifndef BACKEND_HPP
+#define BACKEND_HPP
+
+#include <optional>
+#include <string_view>
+
+// labels as values, for threaded dispatch
+#if defined(__GNUC__) || defined(__clang__)
+#define CHIP8_HAS_COMPUTED_GOTO 1
+#else
+#define CHIP8_HAS_COMPUTED_GOTO 0
+#endif
+
+// native code generation, x86-64 only
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__unix__) || defined(__APPLE__) || defined(_WIN32))
+#define CHIP8_HAS_JIT 1
+#else
+#define CHIP8_HAS_JIT 0
+#endif
+
+namespace core {
+    // how Chip8 dispatches instructions when running a batch of cycles
+    enum class backend
+    {
+        switch_dispatch, // one big switch on the decoded op
+        table_dispatch, // indirect call through a table of handlers
+        threaded_dispatch, // computed goto, each handler jumps to the next
+        block_dispatch, // cached runs of decoded instructions, executed back to back
+        jit // basic blocks recompiled to x86-64
+    };
+
+    const char*            backend_name(backend b) noexcept;
+    std::optional<backend> backend_from_name(std::string_view name) noexcept;
+
+    bool backend_available(backend b) noexcept;
+
+    // chosen at build time by CHIP8_DISPATCH
+    backend default_backend() noexcept;
+} // namespace core
+
+#endif
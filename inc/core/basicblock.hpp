@@ -5,7 +5,9 @@
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <array>
 #include "core/instruction.hpp"
+#include "core/emulatorconstants.hpp"
 
 namespace core {
 
@@ -45,6 +47,12 @@ namespace core {
         std::shared_ptr<basic_block> split(uint16_t                     split_address,
                                            std::shared_ptr<basic_block> this_ptr);
     };
+
+    // linear sweep of memory from start, the block ends with (and includes) the first
+    // instruction for which ends_block is true, or after max_length instructions.
+    // never runs past the last full instruction in memory
+    basic_block scan_block(const std::array<uint8_t, MAX_MEMORY>& memory, uint16_t start,
+                           size_t max_length, bool (*ends_block)(op) = is_jump_or_ret);
 } // namespace core
 
 #endif
\ No newline at end of file
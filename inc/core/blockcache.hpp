@@ -0,0 +1,85 @@
+#ifndef BLOCKCACHE_HPP
+#define BLOCKCACHE_HPP
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "core/decoded.hpp"
+#include "core/emulatorconstants.hpp"
+
+// block interpreter, finds each run of code up to an unconditional jump once and keeps the
+// list of its decoded instructions, then runs the list back to back with nothing but PC
+// kept up to date. a skip or jump that goes somewhere else leaves the block early, so
+// rewriting code rarely means building a block again. breakpoints are only looked at
+// between blocks, and timers only before the instructions that use them. a block that
+// doesn't fit in the cycle budget has as much of it run as fits, so every batch ends on
+// exactly the cycle it was asked to
+
+namespace core {
+
+    class Chip8;
+
+    class BlockCache {
+        struct block {
+            uint16_t start;
+            uint16_t end; // one past the last byte
+
+            // the block's instructions, decoded in place so writes keep them up to date
+            std::vector<const Decoded*> ops;
+
+            // indices of the ops after the first that read or write the timers, which
+            // have to be caught up to their cycle first
+            std::vector<uint8_t> timed;
+
+            // times run, to tell whether compiling it paid off
+            uint32_t runs;
+        };
+
+        Chip8& chip;
+
+        std::array<std::unique_ptr<block>, MAX_MEMORY / 2> by_address = {};
+
+        // how many times in a row the block at every even address was thrown away by writes
+        // before it had run much. past a limit the code there is left to the interpreter,
+        // recompiling self modifying code every time round a loop costs more than it saves
+        std::array<uint8_t, MAX_MEMORY / 2> rewrites = {};
+
+        // whether the instruction at every even address used the timers when the blocks
+        // covering it were built. writes that don't change that can't make a block stale
+        std::array<bool, MAX_MEMORY / 2> timed_at = {};
+
+        // writes to memory, applied between blocks since one may still be running
+        std::vector<std::pair<uint16_t, uint16_t>> pending;
+        // too many writes to keep track of while another backend runs, drop everything
+        bool pending_flush = false;
+
+        block* compile(uint16_t addr);
+        block* lookup_or_compile(uint16_t addr);
+        // whether b is still right after addr was written or had a breakpoint set
+        bool   still_fits(const block& b, uint16_t addr) const noexcept;
+        void   apply_invalidations() noexcept;
+        void   queue(uint16_t addr, uint16_t len) noexcept;
+        void   drop_blocks() noexcept;
+
+        // at most the first count ops of b, from b.start. returns how many ran
+        size_t run_block(const block& b, size_t count);
+
+    public:
+        BlockCache(Chip8& c);
+
+        // returns cycles run, fewer than asked for if a breakpoint was reached
+        size_t run(size_t cycles);
+
+        // memory in [addr, addr + len) has been written
+        void invalidate(uint16_t addr, uint16_t len) noexcept;
+        // a breakpoint has been set or removed at addr
+        void breakpoint_changed(uint16_t addr) noexcept;
+
+        // drop every block, e.g. when a new rom is loaded
+        void flush() noexcept;
+    };
+} // namespace core
+
+#endif
@@ -5,63 +5,178 @@
 #include <array>
 #include <vector>
 #include <string>
-#include "core/timer.hpp"
+#include <memory>
+#include <atomic>
 #include "core/opcodes.hpp"
 #include "core/stack.hpp"
+#include "core/decoded.hpp"
+#include "core/framebuffer.hpp"
+#include "core/machinestate.hpp"
+#include "core/random.hpp"
+#include "core/backend.hpp"
 #include "core/emulatorconstants.hpp"
 
 namespace core {
+    class Jit;
+    class BlockCache;
+
+    // the sound timer starting or running out, and the cycle it happened on
+    struct SoundEvent {
+        size_t cycle = 0;
+        bool   on    = false;
+    };
+
     class Chip8 {
 
     private:
         friend class EmuWrapper;
+        friend class Jit;
+        friend class BlockCache;
 
         void copy_font_data() noexcept;
 
         std::array<uint8_t, MAX_MEMORY> memory = {};
         std::array<uint8_t, 16>         V      = {};
-        std::array<uint8_t, 4>          val    = {};
+
+        // every even address of memory, decoded ahead of time. kept in sync with memory
+        // by write_memory/refresh_decoded, odd addresses are decoded on the fly
+        std::array<Decoded, MAX_MEMORY / 2> decoded = {};
 
         uint16_t I = 0;
         uint16_t PC;
 
         Stack<uint16_t> stack;
 
-        op operation;
-
-        uint16_t opcode;
-
-        size_t cycle_count;
+        // emulated time, in cycles since the rom was loaded. everything the emulator does is
+        // scheduled on this rather than the wall clock, so instances are independent and
+        // deterministic, whatever speed they're run at
+        size_t cycle_count = 0;
+
+        // the cycle the 60Hz timers next tick on, before that cycle's instruction runs.
+        // the first tick has always come one cycle in
+        static constexpr size_t first_timer_event = 1;
+        size_t                  timer_event       = first_timer_event;
+        // cycles from one tick to the next, i.e. instructions per 60Hz frame. a setting
+        // rather than state, so loading a rom leaves it alone
+        size_t cycles_per_tick = CYCLES_PER_FRAME;
+
+        // run whatever is scheduled for the current cycle
+        void run_events() noexcept;
+        // let cycles go by without executing anything, running the events due in them
+        void advance(size_t cycles) noexcept;
+
+        // PC is on an LD_K with no key down, so every cycle until one is pressed would
+        // just execute it again
+        bool waiting_for_key() const noexcept;
+        // cycles run_for let go by like that since the rom was loaded, counted in
+        // cycle_count but never executed
+        size_t waited_cycles = 0;
 
         uint8_t delay_timer = 0;
         uint8_t sound_timer = 0;
 
-        // for CPU freq
-        CETimer<600> timer;
+        // for RND. started over from rng_seed whenever a rom is loaded, so with the same
+        // seed and keys a rom always plays out the same way
+        Random   rng;
+        uint64_t rng_seed = 0;
 
-        bool is_ready;
+        // takes effect now and on every rom loaded after
+        void seed(uint64_t value) noexcept;
+
+        // sound timer starts and stops since EmuWrapper last collected them, only the first
+        // few are kept if nobody does. stamped with the cycle of the timer tick, or of the
+        // LD_ST as far as the backend has counted (the block and jit backends only count
+        // between blocks), never earlier than the one before
+        std::array<SoundEvent, 16> sound_events      = {};
+        size_t                     sound_event_count = 0;
+
+        void sound_changed(size_t cycle, bool on) noexcept;
+
+        // bumped by CLS and DRW, and when a rom is loaded, so a front end can tell whether
+        // the framebuffer needs drawing again without comparing it
+        uint64_t framebuffer_generation = 0;
+
+        // read by other threads to see if a rom is loaded
+        std::atomic<bool> is_ready = false;
 
         uint16_t entry_point;
         uint16_t base_address;
 
         uint16_t fetch(uint16_t addr);
-        op       decode(uint16_t opc);
-        void     execute();
-
-        void cycle();
+        void     execute(const Decoded& ins);
+
+        template<op O>
+        void exec(const Decoded& ins);
+
+        // exec<> for a given op, for the table backend
+        using handler = void (*)(Chip8&, const Decoded&);
+        static handler handler_for(op o) noexcept;
+
+        // execute up to count instructions in a row starting at PC, with no timers or cycle
+        // count in between. stops early after one that jumps or writes memory, returns how
+        // many ran. for the block backend
+        size_t execute_all(const Decoded* const* ins, size_t count);
+
+        // decoded instruction at PC
+        const Decoded& current() noexcept;
+        // scratch space for current() when PC is odd
+        Decoded misaligned;
+
+        backend dispatch = default_backend();
+
+        // skip the cycles of a batch spent waiting for a key, returns false if not waiting
+        bool   skip_key_wait(size_t cycles) noexcept;
+        size_t run_blocks(size_t cycles);
+        void   run_switch(size_t cycles);
+        void run_table(size_t cycles);
+#if CHIP8_HAS_COMPUTED_GOTO
+        void run_threaded(size_t cycles);
+#endif
+
+        // created the first time the jit backend is used
+        std::unique_ptr<Jit> jit;
+        // likewise for the block backend
+        std::unique_ptr<BlockCache> block_cache;
+
+        // owned by EmuWrapper. the block backend stops before executing any address set here
+        const std::array<std::atomic<bool>, MAX_MEMORY>* breakpoints = nullptr;
+        void breakpoint_changed(uint16_t addr) noexcept;
+
+        // decode all of memory into the cache, e.g. after loading a rom
+        void predecode() noexcept;
+        // re-decode the cached instructions overlapping [addr, addr + len)
+        void refresh_decoded(uint16_t addr, uint16_t len = 1) noexcept;
+        // all writes to memory after a rom is loaded should go through here
+        void write_memory(uint16_t addr, uint8_t value) noexcept;
+
+        // execute a single instruction with no frame pacing
+        void step();
+        // execute a batch of instructions with no frame pacing, using the dispatch backend.
+        // returns how many were run, fewer than cycles only if a breakpoint was reached
+        size_t run_for(size_t cycles);
+        // like run_for, but always through the block cache, the one backend that stops
+        // before a breakpoint. the address it starts on isn't checked
+        size_t run_to_breakpoint(size_t cycles);
 
         void update_timers();
 
+        // copy out everything a program can see, false if the stack is too deep to fit
+        bool save_state(MachineState& out) const noexcept;
+        // put a saved state back. only the parts of memory that differ are re-decoded, so
+        // going back a few frames costs little more than the copy
+        void load_state(const MachineState& in) noexcept;
+
         // read file on filesystem with name, write to emu memory beginning @ addr
         void read_file(const std::string& name, uint16_t addr);
         void reset_state();
 
-        std::array<std::array<bool, X_PIXELS>, Y_PIXELS> framebuffer = {};
+        Framebuffer framebuffer = {};
 
         std::array<bool, 16> keys = {};
 
     public:
         Chip8();
+        ~Chip8();
     };
 } // namespace core
 
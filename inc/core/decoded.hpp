@@ -0,0 +1,33 @@
+#ifndef DECODED_HPP
+#define DECODED_HPP
+
+#include <cstdint>
+#include "core/opcodes.hpp"
+
+namespace core {
+    // an opcode decoded once, with every operand field already extracted, so that
+    // executing it never has to look at the raw opcode again
+    struct Decoded {
+        op       operation = op::UNKNOWN;
+        uint8_t  x         = 0; // -X--
+        uint8_t  y         = 0; // --Y-
+        uint8_t  n         = 0; // ---N
+        uint8_t  nn        = 0; // --NN
+        uint16_t nnn       = 0; // -NNN
+        uint16_t opcode    = 0;
+
+        Decoded() = default;
+
+        // opc is in host byte order, i.e. already swapped from memory
+        Decoded(uint16_t opc)
+                : operation{ decode(opc) },
+                  x{ static_cast<uint8_t>((opc >> 8) & 0xF) },
+                  y{ static_cast<uint8_t>((opc >> 4) & 0xF) },
+                  n{ static_cast<uint8_t>(opc & 0xF) },
+                  nn{ static_cast<uint8_t>(opc & 0xFF) },
+                  nnn{ static_cast<uint16_t>(opc & 0xFFF) },
+                  opcode{ opc } {}
+    };
+} // namespace core
+
+#endif
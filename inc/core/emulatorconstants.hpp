@@ -6,4 +6,7 @@
 #define Y_PIXELS 32
 #define X_PIXELS 64
 
+// 600Hz cpu, 60Hz timers and display
+#define CYCLES_PER_FRAME 10
+
 #endif
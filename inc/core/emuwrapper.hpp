@@ -2,16 +2,74 @@
 #define EMUWRAPPER_HPP
 
 #include "core/chip8.hpp"
+#include "core/timer.hpp"
+#include "core/spscqueue.hpp"
+#include "core/snapshot.hpp"
+#include "core/rewind.hpp"
+#include "core/timeline.hpp"
+#include "core/triplebuffer.hpp"
 #include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <optional>
 
 // a wrapper around Chip8 class to allow for debugging functionality
 // without cluttering chip8 class itself
 
 namespace core {
 
+    // a request from another thread (normally the GUI) to the thread running the emulator.
+    // they're carried out in order between batches of instructions
+    struct Command {
+        enum class kind
+        {
+            load_rom, // path, entry, addr, paused
+            pause,
+            continue_emu,
+            single_step,
+            step_over,
+            step_out,
+            clear_destination, // see recv_destination
+            set_breakpoint, // addr
+            remove_breakpoint, // addr
+            poke, // addr, value
+            frame_sync, // value: 1 runs frames when the display asks for them, 0 on the clock
+            cycles_per_frame, // count
+            run_ahead, // count
+            reverse_step,
+            reverse_continue,
+            rewind_length, // count: seconds of history, 0 turns rewinding off
+            rewind, // value: 1 while rewind is held, 0 to carry on
+            save_state, // path
+            load_state // path, see Snapshot::state_failed
+        };
+
+        kind type = kind::pause;
+
+        std::string path;
+
+        uint16_t addr   = 0;
+        uint16_t entry  = 0;
+        uint8_t  value  = 0;
+        bool     paused = false;
+        size_t   count  = 0;
+    };
+
+    // a key going down or up, stamped with when the GUI saw it
+    struct KeyEvent {
+        uint8_t key  = 0;
+        bool    down = false;
+
+        std::chrono::steady_clock::time_point time;
+    };
+
     class EmuWrapper {
-        std::array<bool, MAX_MEMORY> breakpoints = {};
+        // written on the emulation thread, read by the GUI to draw them
+        std::array<std::atomic<bool>, MAX_MEMORY> breakpoints = {};
 
+        // what the last published snapshot held, to work out what changed since
         std::array<uint8_t, MAX_MEMORY> prev_memory = {};
         std::array<uint8_t, 16>         prev_V      = {};
 
@@ -26,33 +84,199 @@ namespace core {
         op       next_operation;
         uint16_t next_opcode;
 
-        bool emu_paused;
-        bool debugging;
+        std::atomic<bool> emu_paused = false;
+        std::atomic<bool> debugging  = false;
         // some debugger functions e.g. step out have a "destination", this variable
         // will be set by those functions, and we can check every cycle if we've reached,
         // and if so, signal to caller (usually GUI windows) of this event, and change
         // state of debugger
-        uint16_t destination = 0xFFFF;
+        std::atomic<uint16_t> destination = 0xFFFF;
 
         void get_next_instruction() noexcept;
         void save_emu_state() noexcept;
-        void update_state() noexcept;
         void set_destination(uint16_t addr) noexcept;
-        void debug_cycle(bool reset_timer = true) noexcept;
 
-    public:
-        std::array<bool, 16> reg_changes = {};
+        TripleBuffer<Snapshot> snapshots;
+        uint64_t               snapshot_version = 0;
+
+        // number of addresses in breakpoints that are set
+        size_t breakpoint_count = 0;
+
+        // keeps run_frame at 60Hz
+        FramePacer<60> pacer;
+
+        // frames are run when vsync asks for them rather than when pacer says so
+        std::atomic<bool> display_sync = false;
+        // frames asked for by vsync and not run yet, and the fraction of one it's owed
+        std::atomic<uint32_t> frames_owed = 0;
+        double                vsync_phase = 0.0;
+
+        // instructions per 60Hz frame, for other threads. the emulator keeps its own copy
+        std::atomic<size_t> frame_cycles = CYCLES_PER_FRAME;
+
+        // emulated frames per real one, and the fraction of a cycle run_frame owes. speed is
+        // read by the audio thread too
+        std::atomic<double> speed      = 1.0;
+        double              cycle_debt = 0.0;
+
+        // sound timer starts and stops for the audio thread, and the cycle they're known up to
+        SpscQueue<SoundEvent, 256> sound_queue;
+        std::atomic<size_t>        sound_until = 0;
+
+        void publish_sound() noexcept;
+
+        // result of the last save_state/load_state command
+        bool state_failed = false;
+
+        // frames run ahead of the real one, and the state they start from
+        size_t       ahead_frames = 0;
+        MachineState ahead_state;
+
+        // the screen as it was after running ahead, published instead of the real one while
+        // ahead_shown is set. its generation never goes backwards, whichever is shown
+        Framebuffer ahead_framebuffer = {};
+        uint64_t    ahead_generation  = 0;
+        bool        ahead_shown       = false;
+
+        // go back to publishing the real screen
+        void drop_run_ahead() noexcept;
 
-        bool I_change  = false;
-        bool PC_change = false;
-        bool dt_change = false;
-        bool st_change = false;
+        // the last few seconds, a state per frame. while rewinding, every frame goes back
+        // one instead of running the program
+        RewindBuffer history;
+        MachineState rewind_state;
+        bool         rewinding = false;
 
+        // carry on from a state. keep_keys leaves the keys as the GUI last set them
+        void restore(const MachineState& state, bool keep_keys) noexcept;
+
+        // checkpoints and key changes, for the debugger to go backwards
+        Timeline     timeline;
+        MachineState checkpoint_state;
+
+        // take a checkpoint if one is due, or start over with one now
+        void checkpoint() noexcept;
+        void restart_timeline() noexcept;
+
+        // load a checkpoint and run from it up to cycle, with the keys as they were.
+        // before_step is called before every instruction
+        template<typename F>
+        void replay(const MachineState& from, size_t cycle, F&& before_step) noexcept;
+        // replay from the newest checkpoint at or before cycle, false if there isn't one
+        bool go_back(size_t cycle) noexcept;
+        void finish_reverse(size_t sound_events, bool was_sounding) noexcept;
+
+        // the emulation thread sleeps on this between frames, while paused and while the
+        // program waits for a key. set_key, send and interrupt wake it up
+        std::mutex              wake_mutex;
+        std::condition_variable wake_cv;
+        bool                    wake_pending = false;
+
+        // waiting on a key with the timers stopped, nothing can happen until a key comes in
+        bool stalled() const noexcept;
+        void wait_for_key() noexcept;
+        // sleep until a point in time, carrying out any commands that arrive meanwhile.
+        // returns early if one of them pauses or unloads the emulator
+        void sleep_until(std::chrono::steady_clock::time_point until) noexcept;
+
+        SpscQueue<Command, 64> commands;
+
+        // key events from the GUI. they're applied at the start of a frame, and each key
+        // changes at most once per frame so a tap shorter than a frame isn't lost. the
+        // rest wait in held_key for the next frame
+        SpscQueue<KeyEvent, 64> key_events;
+        std::optional<KeyEvent> held_key;
+
+        // from a key event being sent to the emulator seeing it
+        std::chrono::steady_clock::duration input_latency = {};
+
+        void apply_input() noexcept;
+        // while paused or without a rom nothing takes events a frame at a time, so keep
+        // only where each key ended up. otherwise the queue fills and set_key blocks
+        void merge_input() noexcept;
+
+        // tickets handed out by send, and the last one carried out
+        uint64_t              sent = 0;
+        std::atomic<uint64_t> done = 0;
+
+        void execute(Command& c) noexcept;
+
+        std::atomic<bool> stopping = false;
+
+    public:
         EmuWrapper();
 
         void new_game(const std::string& filepath, uint16_t entry, uint16_t addr, bool paused);
 
-        std::array<std::array<bool, X_PIXELS>, Y_PIXELS>& frame_buffer() noexcept;
+        // reset and load a rom straight away, for when no other thread is running the emulator.
+        // returns false if the file couldn't be read
+        bool load_rom(const std::string& filepath, uint16_t entry, uint16_t addr);
+
+        // run a number of cycles as fast as possible, ignoring the 600Hz timer. breakpoints
+        // are ignored too, except by the block backend, which stops before one and returns
+        // the number of cycles actually run
+        size_t run_for(size_t cycles) noexcept;
+
+        // run one 60Hz frame worth of cycles, then sleep until the next frame is due unless
+        // frames follow the display. with breakpoints set the frame goes through the block
+        // cache, which stops before one, whatever the backend. while stepping over or out,
+        // cycles go one at a time through cycle(). returns the number of cycles run
+        size_t run_frame() noexcept;
+
+        // run frames when the display refreshes instead of on a 60Hz clock, so every frame
+        // shown has exactly one frame of emulation behind it. the GUI then calls vsync
+        void set_display_sync(bool on) noexcept;
+        bool get_display_sync() const noexcept;
+        // GUI thread only. a frame was just presented on a display refreshing this often.
+        // 60Hz frames are handed out in step, e.g. every other refresh at 120Hz or 5 in
+        // every 12 at 144Hz. rates within 1% of a multiple of 60 count as one
+        void vsync(double refresh_hz) noexcept;
+
+        // instructions run per 60Hz frame, and so between timer ticks. while another thread
+        // runs the emulator, read it from the snapshot instead
+        void   set_cycles_per_frame(size_t cycles) noexcept;
+        size_t get_cycles_per_frame() const noexcept;
+
+        // show the screen as it will be this many frames from now, so input shows up that
+        // much sooner. 0 turns it off. never done while debugging or with breakpoints set
+        void   set_run_ahead(size_t frames) noexcept;
+        size_t get_run_ahead() const noexcept;
+        // run ahead from the current state, keep the screen for the next snapshot and put
+        // everything back. run_frame does this itself, this is for when no other thread is
+        // running the emulator. false if it's off or the state couldn't be saved
+        bool run_ahead() noexcept;
+
+        // keep this many seconds of history to rewind through, 0 turns it off and forgets
+        // what there was
+        void set_rewind_length(size_t seconds);
+        // go back a frame for every one that goes by instead of running, until turned off
+        void set_rewinding(bool on) noexcept;
+
+        // write the emulator's state to a save state file, or carry on from one. false if
+        // no rom is loaded, or the file couldn't be written or isn't a valid state. the
+        // command of the same name does this on the emulation thread, otherwise only call
+        // them when no other thread is running the emulator
+        bool save_state(const std::string& path);
+        bool load_state(const std::string& path);
+        // the whole machine in memory, e.g. to check two runs ended up in the same place.
+        // only when no other thread is running the emulator
+        bool save_state(MachineState& out) const noexcept;
+
+        // scales how much emulated time run_frame covers, 2.0 runs twice as fast. timers
+        // follow the cycle count, so they speed up with it
+        void   set_speed(double multiplier) noexcept;
+        double get_speed() const noexcept;
+
+        // how run_for dispatches instructions
+        void    set_backend(backend b) noexcept;
+        backend get_backend() const noexcept;
+
+        // start RND's sequence over from value, now and whenever a rom is loaded. seeded
+        // from the clock otherwise. for when no other thread is running the emulator
+        void seed(uint64_t value) noexcept;
+
+        // packed, see core/framebuffer.hpp
+        Framebuffer& frame_buffer() noexcept;
 
         Stack<uint16_t>& get_stack() noexcept;
 
@@ -71,10 +295,57 @@ namespace core {
         uint16_t& get_PC() noexcept;
         void      set_PC(uint8_t val) noexcept;
 
-        std::array<uint8_t, MAX_MEMORY>& get_memory() noexcept;
+        const std::array<uint8_t, MAX_MEMORY>& get_memory() const noexcept;
+        // keeps the emulator's decoded instruction cache up to date
+        void write_memory(uint16_t addr, uint8_t val) noexcept;
 
+        // for when no other thread is running the emulator, otherwise use set_key
         std::array<bool, 16>& get_keys() noexcept;
-
+        // queue a key change for the next frame and wake the emulation thread if it's
+        // waiting on one. from one other thread only
+        void set_key(uint8_t key, bool down) noexcept;
+
+        // the program is stopped on LD_K until a key is pressed
+        bool is_waiting_for_key() const noexcept;
+        // wake the emulation thread if it's sleeping, e.g. to shut down
+        void interrupt() noexcept;
+
+        // queue a command for the emulation thread, from one other thread only. returns a
+        // ticket that is_done/wait_done can check on
+        uint64_t send(Command c) noexcept;
+        bool     is_done(uint64_t ticket) const noexcept;
+        void     wait_done(uint64_t ticket) const noexcept;
+
+        // emulation thread only. carry out every queued command, returns false if there were none
+        bool process_commands() noexcept;
+        // emulation thread only. sleep until a command or key arrives
+        void idle() noexcept;
+
+        // emulation thread only. one turn of the emulation loop: carry out queued commands,
+        // then run a frame if a game is running, otherwise sleep until there's something to
+        // do. returns false once stop has been called
+        bool run_batch() noexcept;
+        // make run_batch return false as soon as possible, from any thread
+        void stop() noexcept;
+
+        // emulation thread only. copy the emulator's state out for the GUI. run_frame and
+        // process_commands do this themselves
+        void publish_snapshot() noexcept;
+        // GUI thread only. pick up the latest snapshot, false if nothing new was published.
+        // call it between windows, never while one is still using snapshot()
+        bool update_snapshot() noexcept;
+        // GUI thread only. the snapshot picked up by the last update_snapshot
+        const Snapshot& snapshot() const noexcept;
+
+        // audio thread only. the next time the sound timer started or stopped, oldest first
+        std::optional<SoundEvent> pop_sound_event() noexcept;
+        // any thread. every sound event before this cycle has been published. published
+        // along with the snapshot, and goes back to 0 when a rom is loaded
+        size_t sound_horizon() const noexcept;
+        // any thread. emulated cycles per real second at the current speed
+        double cycles_per_second() const noexcept;
+
+        // restart frame pacing from now, e.g. after being paused
         void reset_timer() noexcept;
 
         // debugger functions
@@ -83,10 +354,16 @@ namespace core {
         void step_out() noexcept;
         void continue_emu() noexcept;
 
-        void reset() noexcept;
         void pause() noexcept;
         void unpause() noexcept;
 
+        // going backwards, only while paused. as far back as the oldest checkpoint, a few
+        // hundred thousand cycles, and never to before a rom or state was loaded or memory
+        // poked. reverse_continue stops on the last breakpoint reached before now, or the
+        // oldest cycle it can get to if there wasn't one
+        bool reverse_step() noexcept;
+        bool reverse_continue() noexcept;
+
         void cycle() noexcept;
         bool reached_destination() const noexcept;
         void recv_destination() noexcept;
@@ -96,6 +373,9 @@ namespace core {
         uint16_t    get_opcode() const noexcept;
 
         uint16_t get_entry() const noexcept;
+        size_t   get_cycle_count() const noexcept;
+        // cycles skipped rather than executed while waiting on LD_K, see Chip8::run_for
+        size_t get_waited_cycles() const noexcept;
 
         bool is_paused() const noexcept;
         bool is_ready() const noexcept;
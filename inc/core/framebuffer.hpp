@@ -0,0 +1,20 @@
+#ifndef FRAMEBUFFER_HPP
+#define FRAMEBUFFER_HPP
+
+#include <array>
+#include <cstdint>
+#include "core/emulatorconstants.hpp"
+
+namespace core {
+    // one 64 bit word per line. the most significant bit is the leftmost pixel, so a
+    // sprite line is drawn with a shift, a rotate and an XOR
+    using Framebuffer = std::array<uint64_t, Y_PIXELS>;
+
+    static_assert(X_PIXELS == 64, "a framebuffer line has to fit a uint64_t exactly");
+
+    constexpr bool pixel_at(const Framebuffer& fb, unsigned x, unsigned y) noexcept {
+        return (fb[y] >> (X_PIXELS - 1 - x)) & 1;
+    }
+} // namespace core
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "core/emulatorconstants.hpp"
+
+// dynamic recompiler, translates basic blocks of chip8 code into x86-64 and runs them
+// out of an executable code cache. blocks are chained together with direct jumps once
+// their successor is known, and thrown away when emulated memory under them is written.
+// JP_V0, LD_K, unknown opcodes, misaligned code and code that keeps getting rewritten are
+// left to the interpreter
+
+namespace core {
+
+    class Chip8;
+
+    // everything generated code needs to know about the emulator, pointed to by rbx
+    // while in the code cache. standard layout, so generated code can use offsetof
+    struct JitContext {
+        uint8_t*  V;
+        uint16_t* PC;
+        uint16_t* I;
+        uint8_t*  delay_timer;
+        bool*     keys;
+        Chip8*    self;
+
+        // native entry point of the block starting at every even address, or null
+        void* const* entry_points;
+
+        // cycles left to run, and cycles until the next 60Hz timer tick
+        int64_t budget;
+        int64_t countdown;
+
+        // set when code memory has been written while in the code cache
+        uint8_t code_dirty;
+    };
+
+    class Jit {
+        struct block {
+            uint16_t start;
+            uint16_t end; // one past the last byte
+
+            uint8_t* code;
+
+            // jumps in other blocks that have been linked to this one
+            std::vector<uint8_t*> incoming;
+
+            // cycle count when compiled, to tell how long it lasted before a write
+            size_t compiled_at;
+
+            bool live;
+        };
+
+        Chip8& chip;
+
+        JitContext ctx = {};
+
+        // code cache, only ever writable or executable, never both
+        uint8_t* cache      = nullptr;
+        size_t   cache_size = 0;
+        uint8_t* cache_free = nullptr;
+        uint8_t* code_start = nullptr; // first byte after the shared stubs
+        size_t   page_size  = 4096;
+
+        // the pages written since the last dispatch, made writable together and turned
+        // back into code before entering the cache again. empty when all of it is code
+        uint8_t* writable_begin = nullptr;
+        uint8_t* writable_end   = nullptr;
+
+        // enters the code cache, returns the address of the exit jump that was taken if it
+        // can be linked to another block, otherwise 0
+        using entry_fn = uintptr_t (*)(JitContext*, const void*);
+        entry_fn enter     = nullptr;
+        uint8_t* exit_stub = nullptr;
+
+        std::vector<std::unique_ptr<block>> blocks;
+
+        std::array<block*, MAX_MEMORY / 2> by_address   = {};
+        std::array<void*, MAX_MEMORY / 2>  entry_points = {};
+
+        // even addresses whose code has to go through the interpreter, until written to
+        std::array<bool, MAX_MEMORY / 2> uncompilable = {};
+
+        // how many times in a row the block at every even address was thrown away by writes
+        // soon after being compiled. past a limit the code there is only interpreted, self
+        // modifying code gets recompiled, relinked and reprotected every time round a loop
+        std::array<uint8_t, MAX_MEMORY / 2> rewrites = {};
+
+        // how many live blocks cover each byte of memory
+        std::array<uint16_t, MAX_MEMORY> coverage = {};
+
+        // writes to code memory, applied once we're back out of the code cache
+        std::vector<std::pair<uint16_t, uint16_t>> pending;
+        // too many writes to keep track of while another backend runs, drop everything
+        bool pending_flush = false;
+
+        // bumped every time the cache is emptied, so stale exits are never linked
+        size_t generation = 0;
+
+        // [at, at + len) is about to be written
+        bool make_writable(uint8_t* at, size_t len) noexcept;
+        bool make_executable() noexcept;
+
+        void   emit_stubs() noexcept;
+        block* compile(uint16_t addr) noexcept;
+        block* lookup_or_compile(uint16_t addr) noexcept;
+        void   link(uint8_t* site, block* target) noexcept;
+        void   kill(block& b) noexcept;
+        void   apply_invalidations() noexcept;
+        void   drop_blocks() noexcept;
+
+        // called from generated code
+        static void    exec_helper(Chip8* self, const void* ins) noexcept;
+        static int64_t tick_helper(Chip8* self, int64_t countdown) noexcept;
+
+    public:
+        Jit(Chip8& c);
+        ~Jit();
+
+        Jit(const Jit&) = delete;
+        Jit& operator=(const Jit&) = delete;
+
+        // false if no executable memory could be had, Chip8 falls back to the interpreter
+        bool usable() const noexcept;
+
+        void run(size_t cycles);
+
+        // memory in [addr, addr + len) has been written
+        void invalidate(uint16_t addr, uint16_t len) noexcept;
+
+        // drop every compiled block, e.g. when a new rom is loaded
+        void flush() noexcept;
+    };
+} // namespace core
+
+#endif
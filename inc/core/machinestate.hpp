@@ -0,0 +1,46 @@
+#ifndef MACHINESTATE_HPP
+#define MACHINESTATE_HPP
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include "core/framebuffer.hpp"
+#include "core/emulatorconstants.hpp"
+
+namespace core {
+
+    // everything a running program can see or change, in one block of plain data so it
+    // can be saved and restored with a copy. caches built from memory aren't part of it,
+    // Chip8::load_state brings them up to date
+    struct MachineState {
+        std::array<uint8_t, MAX_MEMORY> memory      = {};
+        Framebuffer                     framebuffer = {};
+
+        uint64_t cycle_count = 0;
+        uint64_t timer_event = 0;
+
+        // instructions per 60Hz frame, a setting but one that changes what a program sees
+        uint64_t cycles_per_tick = CYCLES_PER_FRAME;
+
+        // RND's generator, see Random
+        std::array<uint64_t, 4> rng = {};
+
+        std::array<uint16_t, 16> stack = {};
+        std::array<uint8_t, 16>  V     = {};
+        std::array<bool, 16>     keys  = {};
+
+        uint16_t I  = 0;
+        uint16_t PC = 0;
+
+        uint8_t stack_size  = 0;
+        uint8_t delay_timer = 0;
+        uint8_t sound_timer = 0;
+        uint8_t reserved    = 0;
+    };
+
+    // no padding, so states can be compared and checksummed as bytes
+    static_assert(std::is_trivially_copyable_v<MachineState>);
+    static_assert(std::has_unique_object_representations_v<MachineState>);
+} // namespace core
+
+#endif
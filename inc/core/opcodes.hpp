@@ -44,6 +44,8 @@ enum class op
 };
 
 bool is_jump_or_call(op opcode);
+// check if `opcode` is an opcode that breaks a basic block
+bool is_jump_or_ret(op opcode);
 bool is_followable(op opcode);
 
 op decode(uint16_t opcode);
@@ -0,0 +1,50 @@
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include <array>
+#include <bit>
+#include <cstdint>
+
+// xoshiro256**, for RND. each emulator has its own, so instances don't share or lock
+// anything, and the whole state is four words that go into save states, which makes a
+// run repeat exactly from any point given the same seed and keys
+
+namespace core {
+
+    struct Random {
+        std::array<uint64_t, 4> state = {};
+
+        // spread a single number over the state with splitmix64, which never gives all
+        // zeros, the one state xoshiro can't leave
+        void seed(uint64_t value) noexcept {
+            for (auto& word : state) {
+                value += 0x9E3779B97F4A7C15ULL;
+
+                auto z = value;
+                z      = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z      = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                word   = z ^ (z >> 31);
+            }
+        }
+
+        uint64_t next() noexcept {
+            auto result = std::rotl(state[1] * 5, 7) * 9;
+            auto t      = state[1] << 17;
+
+            state[2] ^= state[0];
+            state[3] ^= state[1];
+            state[1] ^= state[2];
+            state[0] ^= state[3];
+
+            state[2] ^= t;
+            state[3] = std::rotl(state[3], 45);
+
+            return result;
+        }
+
+        // the low bits are the weakest, use the top ones
+        uint8_t next_byte() noexcept { return static_cast<uint8_t>(next() >> 56); }
+    };
+} // namespace core
+
+#endif
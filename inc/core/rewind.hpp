@@ -0,0 +1,89 @@
+#ifndef REWIND_HPP
+#define REWIND_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "core/machinestate.hpp"
+
+// a history of recent states for rewinding, one per frame. only the newest is kept whole,
+// every older one is stored as the XOR of it and the state after it, run length encoded.
+// a frame rarely changes more than a few dozen bytes of state, so a delta is usually a
+// few hundred bytes and a minute of history fits in a few megabytes
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define CHIP8_HAS_SSE2 1
+#else
+#define CHIP8_HAS_SSE2 0
+#endif
+
+namespace core {
+
+    // deltas work on 16 byte blocks: a run of unchanged blocks and a run of changed ones,
+    // each as a 16 bit count, then the changed blocks XORed together
+    constexpr size_t delta_block  = 16;
+    constexpr size_t delta_blocks = sizeof(MachineState) / delta_block;
+
+    static_assert(sizeof(MachineState) % delta_block == 0);
+    static_assert(delta_blocks < 65536);
+
+    // worst case, every other block changed
+    constexpr size_t max_delta_size = sizeof(MachineState) + 4 * (delta_blocks / 2 + 1);
+
+    // encode the difference between two states into out, which has room for max_delta_size
+    // bytes. returns the encoded size, 0 if they're the same
+    size_t encode_delta(const MachineState& a, const MachineState& b, uint8_t* out) noexcept;
+    // apply a delta from encode_delta to either state, giving the other one. false if the
+    // delta is malformed, state may have been partly changed
+    bool apply_delta(MachineState& state, const uint8_t* delta, size_t size) noexcept;
+
+    class RewindBuffer {
+        struct entry {
+            size_t offset;
+            size_t size;
+        };
+
+        // encoded deltas, oldest first, in a ring of bytes. a delta never wraps, it starts
+        // over at the beginning if there's no room left at the end
+        std::vector<uint8_t> bytes;
+        size_t               write_pos = 0;
+        size_t               used      = 0;
+
+        // where each delta is, in a ring of max_frames
+        std::vector<entry> entries;
+        size_t             first = 0;
+        size_t             count = 0;
+
+        // the newest state, the deltas lead back from it
+        MachineState head;
+        bool         has_head = false;
+
+        std::vector<uint8_t> scratch;
+
+        entry& newest() noexcept;
+        void   drop_oldest() noexcept;
+        // where a delta of size bytes can go, dropping the oldest ones to make room
+        size_t make_room(size_t size) noexcept;
+
+    public:
+        // keep at most frames states back from the newest, in at most max_bytes of deltas.
+        // 0 frames turns it off. forgets everything
+        void configure(size_t frames, size_t max_bytes);
+        bool enabled() const noexcept;
+
+        void clear() noexcept;
+
+        // the state after another frame
+        void push(const MachineState& state) noexcept;
+        // go back a frame. out gets the state before the newest, which is dropped. false
+        // if there's nothing further back
+        bool pop(MachineState& out) noexcept;
+
+        // frames that can be gone back
+        size_t frames() const noexcept;
+        // bytes of deltas kept
+        size_t bytes_used() const noexcept;
+    };
+} // namespace core
+
+#endif
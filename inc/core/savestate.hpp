@@ -0,0 +1,51 @@
+#ifndef SAVESTATE_HPP
+#define SAVESTATE_HPP
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include "core/machinestate.hpp"
+
+// save state files: a header and a MachineState, in the byte order of the machine that
+// wrote them, written and read in one go. anything that doesn't match this build's
+// version and layout exactly, or fails the checksum, is refused
+
+namespace core {
+
+    struct SaveStateHeader {
+        // "CH8STATE", read as a number so a file from the other byte order doesn't match
+        uint64_t magic = 0x4554415453384843ULL;
+
+        // bumped whenever MachineState changes
+        uint32_t version = 2;
+        uint32_t size    = sizeof(MachineState);
+
+        // of state, see state_checksum
+        uint64_t checksum = 0;
+
+        // where the rom was loaded and started, for the debugger
+        uint16_t entry_point  = 0;
+        uint16_t base_address = 0;
+        uint32_t reserved     = 0;
+    };
+
+    struct SaveState {
+        SaveStateHeader header;
+        MachineState    state;
+    };
+
+    static_assert(std::has_unique_object_representations_v<SaveState>);
+
+    uint64_t state_checksum(const MachineState& state) noexcept;
+
+    // fill in the header for state as it is now
+    void seal(SaveState& save) noexcept;
+    // the header matches this build and the checksum matches the state
+    bool is_valid(const SaveState& save) noexcept;
+
+    // false if the file couldn't be written, or read back as a valid state
+    bool write_save_state(const std::string& path, const SaveState& save);
+    bool read_save_state(const std::string& path, SaveState& save);
+} // namespace core
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "core/framebuffer.hpp"
+#include "core/emulatorconstants.hpp"
+
+namespace core {
+
+    // a copy of everything the GUI shows, made by the emulation thread once a frame and
+    // after every command, so nothing on the GUI side reads Chip8 while it's running.
+    // the *_changed fields compare against the snapshot before this one
+    struct Snapshot {
+        // bumped on every publish
+        uint64_t version     = 0;
+        size_t   cycle_count = 0;
+
+        std::array<uint8_t, 16> V = {};
+
+        uint16_t I           = 0;
+        uint16_t PC          = 0;
+        uint8_t  delay_timer = 0;
+        uint8_t  sound_timer = 0;
+
+        std::array<bool, 16> V_changed = {};
+
+        bool I_changed  = false;
+        bool PC_changed = false;
+        bool dt_changed = false;
+        bool st_changed = false;
+
+        // bottom of the stack first. only the first 16 entries are copied
+        std::array<uint16_t, 16> stack      = {};
+        size_t                   stack_size = 0;
+
+        std::array<uint8_t, MAX_MEMORY> memory         = {};
+        std::bitset<MAX_MEMORY>         memory_changed = {};
+
+        Framebuffer framebuffer = {};
+        // see Chip8::framebuffer_generation
+        uint64_t framebuffer_generation = 0;
+
+        uint16_t entry_point = 0;
+
+        // instructions per 60Hz frame. a loaded or rewound state brings its own
+        size_t cycles_per_tick = 0;
+
+        // how long the last key event took to reach the emulator
+        std::chrono::steady_clock::duration input_latency = {};
+
+        bool ready               = false;
+        bool paused              = false;
+        bool debugging           = false;
+        bool waiting_for_key     = false;
+        bool reached_destination = false;
+        // the last save_state or load_state command couldn't be carried out
+        bool state_failed = false;
+
+        // going back through the rewind history, and how many frames are left in it
+        bool   rewinding     = false;
+        size_t rewind_frames = 0;
+
+        // the debugger can step back from here
+        bool can_reverse = false;
+
+        // same as Chip8::fetch, wrapping at the end of memory
+        uint16_t fetch(uint16_t addr) const noexcept {
+            return static_cast<uint16_t>(memory[addr & 0xFFF] << 8 | memory[(addr + 1) & 0xFFF]);
+        }
+    };
+} // namespace core
+
+#endif
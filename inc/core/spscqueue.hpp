@@ -0,0 +1,51 @@
+#ifndef SPSCQUEUE_HPP
+#define SPSCQUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+// bounded lock-free queue for exactly one producer thread and one consumer thread.
+// head is only written by the consumer and tail only by the producer, each on its own
+// cache line so the two threads don't fight over it
+template<typename T, size_t N>
+class SpscQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+    std::array<T, N> slots = {};
+
+    alignas(64) std::atomic<size_t> head = 0; // next slot to pop
+    alignas(64) std::atomic<size_t> tail = 0; // next slot to push
+
+public:
+    // producer only. false if the queue is full
+    bool push(T value) {
+        auto t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        slots[t & (N - 1)] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only
+    std::optional<T> pop() {
+        auto h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return std::nullopt;
+        }
+        std::optional<T> value = std::move(slots[h & (N - 1)]);
+        head.store(h + 1, std::memory_order_release);
+        return value;
+    }
+
+    // either side, only a hint since the other side may be changing it
+    bool empty() const noexcept {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+#endif
@@ -3,11 +3,10 @@
 
 #include <vector>
 #include <cstdint>
-#include <mutex>
 
-// normally i would use a std::stack or std::deque out of laziness, but debugger
-// requires viewing the stack of emulator while running, and it would be silly
-// to pop/push a million times just to look at its contents
+// normally i would use a std::stack or std::deque out of laziness, but the debugger
+// snapshot copies the stack out every frame, and it would be silly to pop/push a
+// million times just to look at its contents
 
 template<typename T>
 class Stack {
@@ -21,11 +20,6 @@ class Stack {
     std::vector<T> data;
 
 public:
-    // with the way imgui works, we'll have to read every frame to draw. it is possible
-    // for there to be reading the stack by debugger and resizing of data vector, which
-    // could segfault
-    std::mutex mut;
-
     Stack() = default;
 
     Stack(size_t reserve_size) { data.reserve(reserve_size); }
@@ -0,0 +1,58 @@
+#ifndef TIMELINE_HPP
+#define TIMELINE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "core/machinestate.hpp"
+
+// what the debugger needs to go backwards: a checkpoint of the machine every so often and
+// every key change since the oldest one. the program is deterministic given its keys, so
+// any cycle after the oldest checkpoint can be reached again by loading the checkpoint
+// before it and re-running, which costs at most one interval of cycles
+
+namespace core {
+
+    struct KeyChange {
+        // the keys were set to this before the instruction on cycle ran
+        size_t               cycle = 0;
+        std::array<bool, 16> keys  = {};
+    };
+
+    class Timeline {
+        // a ring of checkpoints, oldest first
+        std::vector<MachineState> checkpoints;
+        size_t                    first = 0;
+        size_t                    count = 0;
+
+        // every key change since the oldest checkpoint, in order
+        std::deque<KeyChange> key_log;
+
+    public:
+        // cycles between checkpoints, at least. they're only taken between frames
+        static constexpr size_t interval = 1000;
+        // 256 checkpoints of 4.5KB each, about a megabyte
+        static constexpr size_t capacity = 256;
+
+        Timeline();
+
+        void clear() noexcept;
+        // forget everything after cycle, e.g. once the program has been taken back there
+        // and carries on differently
+        void truncate(size_t cycle) noexcept;
+
+        // whether a checkpoint should be taken at cycle
+        bool due(size_t cycle) const noexcept;
+        void add_checkpoint(const MachineState& state) noexcept;
+        void key_changed(size_t cycle, const std::array<bool, 16>& keys);
+
+        // the newest checkpoint from cycle or before, or null if there isn't one
+        const MachineState* checkpoint_at(size_t cycle) const noexcept;
+
+        const std::deque<KeyChange>& keys() const noexcept;
+    };
+} // namespace core
+
+#endif
@@ -1,55 +1,44 @@
+#ifndef TIMER_HPP
+#define TIMER_HPP
+
 #include <chrono>
+#include <thread>
 
-// constexpr timer
+// paces a loop to a fixed rate by sleeping until each deadline, instead of polling the
+// clock. if we fall more than a period behind (e.g. the process was suspended), the
+// schedule restarts from now rather than running a burst of frames to catch up
 template<int64_t f>
-class CETimer {
-    using clock = std::chrono::steady_clock;
-
-public:
-    CETimer() {}
+class FramePacer {
+    using clock  = std::chrono::steady_clock;
+    using period = std::chrono::duration<int64_t, std::ratio<1, f>>;
 
-    bool update() {
+    clock::time_point deadline = clock::now();
 
-        static auto start = clock::now();
+public:
+    // start a new schedule, the next deadline is a period from now
+    void reset() {
+        deadline = clock::now() + std::chrono::duration_cast<clock::duration>(period{ 1 });
+    }
 
-        static std::chrono::duration<int64_t, std::ratio<1, f>> duration{ 1 };
+    // when the current period ends
+    clock::time_point due() const noexcept { return deadline; }
 
-        static auto next_tick = start + duration;
+    // move on to the next period, once the current one is over
+    void next() {
+        auto now = clock::now();
 
-        if (clock::now() > next_tick) {
-            next_tick += duration;
-            return true;
+        if (now - deadline > period{ 1 }) {
+            deadline = now;
         }
-        return false;
+
+        deadline += std::chrono::duration_cast<clock::duration>(period{ 1 });
     }
 
-    // just run the timer until it stops returning true, for now
-    void reset() {
-        while (update())
-            ;
+    // sleep until the current deadline, then move on to the next
+    void wait() {
+        std::this_thread::sleep_until(deadline);
+        next();
     }
 };
 
-class Timer {
-    using clock = std::chrono::steady_clock;
-
-    clock::time_point start;
-
-    double count;
-
-    double period_ns;
-
-public:
-    Timer(size_t freq) : start{ clock::now() }, count{ 0 }, period_ns(1000000000.0 / freq) {}
-
-    bool update() {
-        // how many nanosecond ticks have gone by since starting?
-        std::chrono::duration<double, std::nano> elapsed = clock::now() - start;
-
-        if (elapsed.count() > count) {
-            count = elapsed.count() + period_ns;
-            return true;
-        }
-        return false;
-    }
-};
\ No newline at end of file
+#endif
@@ -0,0 +1,48 @@
+#ifndef TRIPLEBUFFER_HPP
+#define TRIPLEBUFFER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// hands the latest of a series of values from exactly one producer thread to exactly one
+// consumer thread. the producer fills its back buffer and swaps it with the middle one, the
+// consumer swaps the middle one for its front buffer when there's something new in it.
+// nobody ever waits, and nobody ever sees a buffer the other side is using
+template<typename T>
+class TripleBuffer {
+    // set in middle while it holds something the consumer hasn't picked up yet
+    static constexpr uint8_t fresh = 4;
+
+    std::array<T, 3> buffers = {};
+
+    uint8_t back  = 0; // producer only
+    uint8_t front = 1; // consumer only
+
+    alignas(64) std::atomic<uint8_t> middle = 2;
+
+public:
+    // producer only. the buffer can hold anything, it has to be filled in completely
+    T& write_buffer() noexcept { return buffers[back]; }
+
+    // producer only. make the write buffer visible to the consumer
+    void publish() noexcept {
+        auto old = middle.exchange(static_cast<uint8_t>(back | fresh), std::memory_order_acq_rel);
+        back     = old & ~fresh;
+    }
+
+    // consumer only. pick up the newest published buffer, false if there wasn't one.
+    // anything read() returned before stays valid until the next call
+    bool update() noexcept {
+        if ((middle.load(std::memory_order_relaxed) & fresh) == 0) {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & ~fresh;
+        return true;
+    }
+
+    // consumer only
+    const T& read() const noexcept { return buffers[front]; }
+};
+
+#endif
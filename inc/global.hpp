@@ -4,6 +4,8 @@
 #include <imgui.h>
 #include <vector>
 #include "input/keymap.hpp"
+#include "core/emulatorconstants.hpp"
+#include "gui/upscale.hpp"
 
 class global {
 
@@ -16,6 +18,21 @@ class global {
 
     ImGuiID m_dock_id;
 
+    GUI::upscale::filter m_upscaler = GUI::upscale::filter::none;
+
+    // share of a pixel's brightness left after a 60Hz frame once it goes dark, 0 is off
+    float m_persistence = 0.0f;
+
+    // run a frame of emulation per displayed frame instead of on the emulator's own clock
+    bool m_frame_sync             = false;
+    int  m_instructions_per_frame = CYCLES_PER_FRAME;
+
+    // frames to run ahead of the real one, see EmuWrapper::set_run_ahead
+    int m_run_ahead = 0;
+
+    // seconds of history kept to rewind through, 0 is off
+    int m_rewind_seconds = 30;
+
 private:
     global() = default;
 
@@ -36,6 +53,18 @@ public:
     static input::Keys& keymap() { return get().m_keymap; }
 
     static ImGuiID& dock_id() { return get().m_dock_id; }
+
+    static GUI::upscale::filter& upscaler() { return get().m_upscaler; }
+
+    static float& persistence() { return get().m_persistence; }
+
+    static bool& frame_sync() { return get().m_frame_sync; }
+
+    static int& instructions_per_frame() { return get().m_instructions_per_frame; }
+
+    static int& run_ahead() { return get().m_run_ahead; }
+
+    static int& rewind_seconds() { return get().m_rewind_seconds; }
 };
 
 #endif
\ No newline at end of file
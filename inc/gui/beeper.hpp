@@ -0,0 +1,49 @@
+#ifndef BEEPER_HPP
+#define BEEPER_HPP
+
+#include <SDL.h>
+#include <cstddef>
+#include "core/emuwrapper.hpp"
+
+namespace GUI {
+    // plays a square wave while the sound timer runs. the audio callback follows the
+    // emulator's cycle count through the sound events it publishes, a couple of frames
+    // behind so frame to frame jitter doesn't cut beeps short. no locks or allocations
+    // on the audio thread
+    class Beeper {
+        core::EmuWrapper& emu;
+
+        SDL_AudioDeviceID device      = 0;
+        int               sample_rate = 0;
+
+        // audio thread only. emulated cycle the next sample is for, and the last horizon seen
+        double clock   = 0.0;
+        size_t horizon = 0;
+        // ran out of published cycles, wait until we're a full latency behind again
+        bool buffering = true;
+
+        // an event popped from the queue that isn't due yet
+        core::SoundEvent next     = {};
+        bool             has_next = false;
+
+        bool   on        = false;
+        float  amplitude = 0.0f;
+        double phase     = 0.0;
+
+        static void callback(void* userdata, Uint8* stream, int len);
+        void        fill(float* out, size_t count) noexcept;
+
+    public:
+        Beeper(core::EmuWrapper& e);
+        ~Beeper();
+
+        Beeper(const Beeper&) = delete;
+        Beeper& operator=(const Beeper&) = delete;
+
+        // false if there's no audio device, the emulator runs silent
+        bool open();
+        void close();
+    };
+} // namespace GUI
+
+#endif
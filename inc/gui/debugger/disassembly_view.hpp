@@ -25,6 +25,9 @@ namespace GUI {
 
         float last_scroll_val;
 
+        // scroll to PC once the snapshot shows we've paused
+        bool follow_pc = false;
+
         void first_analysis();
 
         bool  show_left();
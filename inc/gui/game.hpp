@@ -1,18 +1,55 @@
 #ifndef GAME_HPP
 #define GAME_HPP
 
+#include <SDL.h>
+#include <array>
+#include <chrono>
+#include <vector>
 #include "gui/guicomponent.hpp"
+#include "gui/upscale.hpp"
 #include "core/emuwrapper.hpp"
 
 namespace GUI {
     class Game : public GUIComponent {
         core::EmuWrapper& emu;
 
+        // the framebuffer as a streaming texture. unfiltered, only rows that changed are
+        // uploaded, otherwise the whole upscaled screen is, once per DRW/CLS
+        SDL_Renderer* renderer      = nullptr;
+        SDL_Texture*  texture       = nullptr;
+        int           texture_scale = 1;
+
+        // what's in the texture, so we know what to upload
+        core::Framebuffer uploaded            = {};
+        uint64_t          uploaded_generation = ~0ULL;
+        uint32_t          uploaded_on         = 0;
+        uint32_t          uploaded_off        = 0;
+        upscale::filter   uploaded_filter     = upscale::filter::none;
+
+        std::vector<uint64_t> scaled;
+
+        // phosphor persistence, a brightness per texture pixel faded every displayed frame
+        std::vector<uint8_t>                  intensity;
+        std::array<uint32_t, 256>             palette      = {};
+        bool                                  fading       = false;
+        std::chrono::steady_clock::time_point last_persist = {};
+
+        void persist_texture(const core::Snapshot& snap, uint32_t on, uint32_t off);
+
+        void update_texture(const core::Snapshot& snap, uint32_t on, uint32_t off);
+
     public:
         Game(core::EmuWrapper& e);
 
+        // the renderer has to exist first, and the texture has to go before it does
+        void create_texture(SDL_Renderer* r, int scale = 1);
+        void destroy_texture();
+
         virtual void draw_window() override;
+
+        // pixels are still fading, so the screen changes even if the framebuffer doesn't
+        bool animating() const noexcept;
     };
 } // namespace GUI
 
-#endif
\ No newline at end of file
+#endif
@@ -2,8 +2,11 @@
 #include <imgui.h>
 #include "core/emuwrapper.hpp"
 #include "gui/guicomponent.hpp"
+#include "gui/beeper.hpp"
 #include "gui/game.hpp"
+#include <chrono>
 #include <memory>
+#include <string>
 
 namespace GUI {
     class Main {
@@ -15,18 +18,46 @@ namespace GUI {
 
         core::EmuWrapper emu;
 
+        Beeper beeper;
+
         Game game_window;
 
         std::vector<std::unique_ptr<GUIComponent>> windows;
 
         bool done = false;
 
+        // what the emulator was last told about timing, and the display it follows
+        bool   display_synced    = false;
+        int    sent_instructions = CYCLES_PER_FRAME;
+        int    sent_run_ahead    = 0;
+        int    sent_rewind       = 0;
+        double refresh_rate      = 0.0;
+
+        std::chrono::steady_clock::time_point last_vsync;
+
+        // save states go in numbered slot files here
+        static constexpr int slot_count = 4;
+        std::string          state_dir;
+        // slots asked for from a menu or hotkey, 0 for none. carried out between frames
+        int save_request = 0;
+        int load_request = 0;
+
+        std::string slot_path(int slot) const;
+        void        handle_slots();
+
+        // pass timing settings on to the emulator when they change
+        void sync_settings();
+        // ask the emulator for the frames due by the next vsync
+        void request_frames();
+
         void style();
 
         void prepare_imgui();
 
-        void draw();
-        void handle_input();
+        // with locked set, the emulator runs the next frame while this one is presented
+        void draw(bool locked);
+        // wait up to timeout_ms for events and handle them, false if there were none
+        bool handle_input(int timeout_ms);
 
     public:
         Main();
@@ -19,7 +19,9 @@ namespace GUI {
         ARROW_RIGHT,
         ARROW_LEFT_INACTIVE,
         ARROW_RIGHT_INACTIVE,
-        ARROW_RIGHT_PC
+        ARROW_RIGHT_PC,
+        REVERSE_STEP,
+        REVERSE_CONTINUE
     };
 
     std::vector<SDL_Texture*> generate_icons(int font_size, SDL_Renderer* renderer);
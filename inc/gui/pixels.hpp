@@ -0,0 +1,43 @@
+#ifndef PIXELS_HPP
+#define PIXELS_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include "core/framebuffer.hpp"
+
+// turning the packed framebuffer into 32 bit pixels for a texture. nothing here knows about
+// SDL or imgui, colours are whatever 32 bit format the caller's texture uses
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define GUI_HAS_SSE2 1
+#else
+#define GUI_HAS_SSE2 0
+#endif
+
+namespace GUI::pixels {
+
+    // write the X_PIXELS pixels of a framebuffer line to out, on for lit pixels and off
+    // for dark ones
+    void expand_line(uint64_t line, uint32_t on, uint32_t off, uint32_t* out) noexcept;
+
+    // expand count lines of words * 64 pixels, packed like the framebuffer, into rows of
+    // pitch bytes starting at out
+    void expand(const uint64_t* lines, size_t count, size_t words, uint32_t on, uint32_t off,
+                void* out, size_t pitch) noexcept;
+
+    // phosphor persistence. intensity holds a byte per pixel of the same image: lit pixels
+    // go to 255 and dark ones fade to keep / 256 of what they were. returns true if any
+    // pixel is still fading
+    bool persist(const uint64_t* lines, size_t count, size_t words, uint32_t keep,
+                 uint8_t* intensity) noexcept;
+
+    // every intensity blended from off at 0 to on at 255, for colourise
+    std::array<uint32_t, 256> make_palette(uint32_t on, uint32_t off) noexcept;
+
+    // count rows of width intensities into rows of pitch bytes through a palette
+    void colourise(const uint8_t* intensity, size_t count, size_t width,
+                   const std::array<uint32_t, 256>& palette, void* out, size_t pitch) noexcept;
+} // namespace GUI::pixels
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef UPSCALE_HPP
+#define UPSCALE_HPP
+
+#include <cstdint>
+#include <vector>
+#include "core/framebuffer.hpp"
+
+// pixel art upscalers for the game screen. the framebuffer only has two colours, so every
+// rule works on whole 64 pixel lines at once with bitwise operations, and the output is
+// another packed bit image rather than colours
+
+namespace GUI::upscale {
+
+    enum class filter
+    {
+        none,
+        scale2x, // also known as EPX
+        scale3x,
+        xbr // xBR level 1 rules at 2x, the 4x4 neighbourhood keeps diagonals smoother
+    };
+
+    inline constexpr filter all_filters[] = { filter::none, filter::scale2x, filter::scale3x,
+                                              filter::xbr };
+
+    const char* name(filter f) noexcept;
+
+    // how many times bigger each side of the output is
+    int factor(filter f) noexcept;
+
+    // upscale fb into Y_PIXELS * factor lines of X_PIXELS * factor pixels, factor words
+    // per line with the leftmost pixel in the top bit of the first word, like Framebuffer
+    void apply(filter f, const core::Framebuffer& fb, std::vector<uint64_t>& out);
+} // namespace GUI::upscale
+
+#endif
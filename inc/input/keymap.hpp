@@ -1,5 +1,6 @@
 #ifndef KEYMAP_HPP
 #define KEYMAP_HPP
+#include <array>
 #include <vector>
 #include <optional>
 #include <SDL.h>
@@ -9,6 +10,14 @@ namespace input {
     class Keys {
         std::vector<std::pair<SDL_Keycode, uint8_t>> data;
 
+        // chip8 key for each keycode, or -1. printable keys are their own character and
+        // every other key is a scancode with SDLK_SCANCODE_MASK set, so all but a few
+        // layout specific keycodes get a slot. rebuilt from data whenever it changes
+        std::array<int8_t, 128 + SDL_NUM_SCANCODES> lookup;
+
+        static std::optional<size_t> slot(SDL_Keycode k) noexcept;
+        void                         rebuild() noexcept;
+
     public:
         Keys();
 
@@ -18,7 +27,8 @@ namespace input {
         // if successful, returns false otherwise
         bool change_key(SDL_Keycode from, SDL_Keycode to);
 
-        std::pair<SDL_Keycode, uint8_t>& operator[](size_t v) noexcept;
+        // use change_key to rebind, so the lookup table follows
+        const std::pair<SDL_Keycode, uint8_t>& operator[](size_t v) const noexcept;
 
         std::optional<uint8_t> translate_key(SDL_Keycode k) const noexcept;
 
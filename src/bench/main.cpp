@@ -0,0 +1,258 @@
+#include "core/emuwrapper.hpp"
+#include <fmt/format.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+#include <cstring>
+
+// runs the same roms through every available dispatch backend and compares
+// instructions per second against the switch interpreter. with --run-ahead, also
+// measures what running ahead adds to every 60Hz frame
+
+namespace {
+
+    struct options {
+        std::vector<std::string> roms;
+
+        uint16_t entry        = 0x200;
+        uint16_t base_address = 0x200;
+
+        size_t cycles  = 20'000'000;
+        size_t repeats = 3;
+
+        size_t run_ahead = 0;
+    };
+
+    struct result {
+        double seconds = 0.0;
+
+        // final state, to make sure every backend agrees. all of it, memory, stack,
+        // timers and cycle counts included
+        core::MachineState state = {};
+
+        bool same_state(const result& other) const {
+            return std::memcmp(&state, &other.state, sizeof(state)) == 0;
+        }
+    };
+
+    void usage() {
+        fmt::print("usage: chip8bench <rom>... [options]\n"
+                   "  --entry <hex>      entry point (default 200)\n"
+                   "  --base <hex>       address roms are loaded at (default 200)\n"
+                   "  --cycles <n>       instructions per run (default 20000000)\n"
+                   "  --repeat <n>       runs per backend, best is kept (default 3)\n"
+                   "  --run-ahead <n>    also time running n frames ahead every frame\n");
+    }
+
+    bool parse_number(const std::string& s, size_t& out, int base) {
+        try {
+            size_t pos = 0;
+            out        = std::stoull(s, &pos, base);
+            return pos == s.size();
+        }
+        catch (...) {
+            return false;
+        }
+    }
+
+    bool parse_args(int argc, char** argv, options& opts) {
+        for (auto i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+
+            size_t number = 0;
+
+            auto next_number = [&](int base) {
+                return i + 1 < argc && parse_number(argv[++i], number, base);
+            };
+
+            if (arg == "--entry" || arg == "--base") {
+                if (!next_number(16) || number >= MAX_MEMORY) {
+                    fmt::print(stderr, "invalid address for {}\n", arg);
+                    return false;
+                }
+                (arg == "--entry" ? opts.entry : opts.base_address) = static_cast<uint16_t>(number);
+            }
+            else if (arg == "--cycles" || arg == "--repeat") {
+                if (!next_number(10) || number == 0) {
+                    fmt::print(stderr, "invalid count for {}\n", arg);
+                    return false;
+                }
+                (arg == "--cycles" ? opts.cycles : opts.repeats) = number;
+            }
+            else if (arg == "--run-ahead") {
+                if (!next_number(10)) {
+                    fmt::print(stderr, "invalid count for {}\n", arg);
+                    return false;
+                }
+                opts.run_ahead = number;
+            }
+            else if (arg == "--help" || arg == "-h") {
+                return false;
+            }
+            else if (!arg.starts_with("--")) {
+                opts.roms.push_back(arg);
+            }
+            else {
+                fmt::print(stderr, "unknown argument {}\n", arg);
+                return false;
+            }
+        }
+        return !opts.roms.empty();
+    }
+
+    bool run_once(core::EmuWrapper& emu, const options& opts, const std::string& rom,
+                  result& out) {
+        if (!emu.load_rom(rom, opts.entry, opts.base_address)) {
+            return false;
+        }
+
+        // same RND sequence for every run, so backends can be compared
+        emu.seed(1);
+
+        using clock = std::chrono::steady_clock;
+
+        auto start = clock::now();
+        emu.run_for(opts.cycles);
+        std::chrono::duration<double> elapsed = clock::now() - start;
+
+        out.seconds = elapsed.count();
+        return emu.save_state(out.state);
+    }
+
+    // the same frames with and without running ahead after each one, which mustn't change
+    // where the program ends up
+    bool run_frames(core::EmuWrapper& emu, const options& opts, const std::string& rom,
+                    size_t ahead, result& out) {
+        if (!emu.load_rom(rom, opts.entry, opts.base_address)) {
+            return false;
+        }
+        emu.set_run_ahead(ahead);
+
+        emu.seed(1);
+
+        using clock = std::chrono::steady_clock;
+
+        auto frames = opts.cycles / CYCLES_PER_FRAME;
+
+        auto start = clock::now();
+        for (size_t f = 0; f < frames; ++f) {
+            emu.run_for(CYCLES_PER_FRAME);
+            emu.run_ahead();
+        }
+        std::chrono::duration<double> elapsed = clock::now() - start;
+
+        out.seconds = elapsed.count() / static_cast<double>(frames);
+        return emu.save_state(out.state);
+    }
+
+    bool bench_run_ahead(core::EmuWrapper& emu, const options& opts, const std::string& rom,
+                         bool& mismatch) {
+        // the backends were compared above, only the default one is timed here
+        emu.set_backend(core::default_backend());
+
+        result plain;
+        result ahead;
+        plain.seconds = ahead.seconds = std::numeric_limits<double>::max();
+
+        for (size_t r = 0; r < opts.repeats; ++r) {
+            result current;
+            if (!run_frames(emu, opts, rom, 0, current)) {
+                return false;
+            }
+            if (current.seconds < plain.seconds) {
+                plain = current;
+            }
+            if (!run_frames(emu, opts, rom, opts.run_ahead, current)) {
+                return false;
+            }
+            if (current.seconds < ahead.seconds) {
+                ahead = current;
+            }
+        }
+        emu.set_run_ahead(0);
+
+        constexpr double frame_budget = 1.0 / 60.0;
+
+        auto overhead = std::max(ahead.seconds - plain.seconds, 0.0);
+
+        bool same = plain.same_state(ahead);
+        mismatch |= !same;
+
+        fmt::print("  run ahead {} {:>8.2f}us/frame {:>8.2f}us without {:>7.3f}% of a frame{}\n",
+                   opts.run_ahead, ahead.seconds * 1e6, plain.seconds * 1e6,
+                   overhead / frame_budget * 100.0, same ? "" : "  STATE MISMATCH");
+        return true;
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    options opts;
+
+    if (!parse_args(argc, argv, opts)) {
+        usage();
+        return 1;
+    }
+
+    constexpr core::backend all_backends[] = { core::backend::switch_dispatch,
+                                               core::backend::table_dispatch,
+                                               core::backend::threaded_dispatch,
+                                               core::backend::block_dispatch,
+                                               core::backend::jit };
+
+    bool mismatch = false;
+
+    core::EmuWrapper emu;
+
+    for (auto& rom : opts.roms) {
+        fmt::print("{} ({} instructions, best of {})\n", rom, opts.cycles, opts.repeats);
+
+        result baseline;
+
+        for (auto b : all_backends) {
+            if (!core::backend_available(b)) {
+                fmt::print("  {:<10} unavailable\n", core::backend_name(b));
+                continue;
+            }
+
+            emu.set_backend(b);
+
+            result best;
+            best.seconds = std::numeric_limits<double>::max();
+
+            for (size_t r = 0; r < opts.repeats; ++r) {
+                result current;
+                if (!run_once(emu, opts, rom, current)) {
+                    fmt::print(stderr, "couldn't open rom {}\n", rom);
+                    return 1;
+                }
+                if (current.seconds < best.seconds) {
+                    best = current;
+                }
+            }
+
+            if (b == core::backend::switch_dispatch) {
+                baseline = best;
+            }
+
+            bool same = baseline.same_state(best);
+            mismatch |= !same;
+
+            double ips = opts.cycles / std::max(best.seconds, 1e-9);
+
+            fmt::print("  {:<10} {:>8.3f}s {:>14.0f} instructions/s {:>6.2f}x{}\n",
+                       core::backend_name(b), best.seconds, ips,
+                       baseline.seconds / std::max(best.seconds, 1e-9),
+                       same ? "" : "  STATE MISMATCH");
+        }
+
+        if (opts.run_ahead > 0 && !bench_run_ahead(emu, opts, rom, mismatch)) {
+            fmt::print(stderr, "couldn't open rom {}\n", rom);
+            return 1;
+        }
+    }
+
+    return mismatch ? 2 : 0;
+}
@@ -0,0 +1,61 @@
+#include "core/backend.hpp"
+#include <array>
+
+#ifndef CHIP8_DEFAULT_BACKEND
+#define CHIP8_DEFAULT_BACKEND switch_dispatch
+#endif
+
+namespace {
+    struct backend_info {
+        core::backend    type;
+        std::string_view name;
+    };
+
+    constexpr std::array<backend_info, 5> backends = { {
+            { core::backend::switch_dispatch, "switch" },
+            { core::backend::table_dispatch, "table" },
+            { core::backend::threaded_dispatch, "threaded" },
+            { core::backend::block_dispatch, "block" },
+            { core::backend::jit, "jit" },
+    } };
+} // namespace
+
+namespace core {
+    const char* backend_name(backend b) noexcept {
+        for (auto& info : backends) {
+            if (info.type == b) {
+                return info.name.data();
+            }
+        }
+        return "unknown";
+    }
+
+    std::optional<backend> backend_from_name(std::string_view name) noexcept {
+        for (auto& info : backends) {
+            if (info.name == name) {
+                return info.type;
+            }
+        }
+        return std::nullopt;
+    }
+
+    bool backend_available(backend b) noexcept {
+        switch (b) {
+        case backend::threaded_dispatch: {
+            return CHIP8_HAS_COMPUTED_GOTO;
+        }
+        case backend::jit: {
+            return CHIP8_HAS_JIT;
+        }
+        default: {
+            return true;
+        }
+        }
+    }
+
+    backend default_backend() noexcept {
+        constexpr auto b = backend::CHIP8_DEFAULT_BACKEND;
+        // fall back to switch if the build asked for something this compiler can't do
+        return backend_available(b) ? b : backend::switch_dispatch;
+    }
+} // namespace core
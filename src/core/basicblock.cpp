@@ -1,5 +1,6 @@
 #include "core/basicblock.hpp"
 
+#include <algorithm>
 #include <utility>
 
 namespace core {
@@ -97,4 +98,22 @@ namespace core {
 
         return new_block;
     }
+
+    basic_block scan_block(const std::array<uint8_t, MAX_MEMORY>& memory, uint16_t start,
+                           size_t max_length, bool (*ends_block)(op)) {
+        basic_block block;
+
+        for (uint16_t addr = start; addr < MAX_MEMORY - 1 && block.instructions.size() < max_length;
+             addr += 2) {
+            // memory is big endian, Instruction wants host order
+            uint16_t opc = (memory[addr] << 8) | memory[addr + 1];
+
+            block.append(addr, opc);
+
+            if (ends_block(block.instructions.back().operation)) {
+                break;
+            }
+        }
+        return block;
+    }
 } // namespace core
\ No newline at end of file
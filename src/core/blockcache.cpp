@@ -0,0 +1,235 @@
+#include "core/blockcache.hpp"
+#include "core/chip8.hpp"
+#include "core/basicblock.hpp"
+#include <algorithm>
+
+namespace {
+
+    constexpr size_t max_block_length = 64;
+    constexpr size_t max_pending      = 256;
+    // a block thrown away by writes before running this many times didn't pay for itself
+    constexpr uint32_t min_runs = 16;
+    // times in a row that can happen before its code is only interpreted
+    constexpr uint8_t max_rewrites = 8;
+
+    // nothing after these runs straight on from them. a skip only sometimes leaves,
+    // execute_all finds out when it runs
+    bool ends_block(op o) {
+        return o == op::JP || o == op::JP_V0 || o == op::RET || o == op::CALL || o == op::SYS ||
+               o == op::LD_K || o == op::UNKNOWN || o == op::LD_B || o == op::DUMP;
+    }
+
+    // the timers are caught up to the cycle of these before they run
+    bool uses_timers(op o) { return o == op::LD_DT || o == op::LD_DT2 || o == op::LD_ST; }
+} // namespace
+
+namespace core {
+
+    BlockCache::BlockCache(Chip8& c) : chip{ c } {}
+
+    BlockCache::block* BlockCache::compile(uint16_t addr) {
+        auto bb = scan_block(chip.memory, addr, max_block_length, ends_block);
+
+        auto b   = std::make_unique<block>();
+        b->start = addr;
+        b->runs  = 0;
+
+        for (auto& i : bb.instructions) {
+            bool first = b->ops.empty();
+
+            if (!first && chip.breakpoints != nullptr && (*chip.breakpoints)[i.address]) {
+                break;
+            }
+
+            const auto& d = chip.decoded[i.address >> 1];
+
+            timed_at[i.address >> 1] = uses_timers(d.operation);
+
+            // the first instruction's timers are always caught up
+            if (!first && uses_timers(d.operation)) {
+                b->timed.push_back(static_cast<uint8_t>(b->ops.size()));
+            }
+            b->ops.push_back(&d);
+        }
+
+        b->end = static_cast<uint16_t>(addr + 2 * b->ops.size());
+
+        by_address[addr >> 1] = std::move(b);
+        return by_address[addr >> 1].get();
+    }
+
+    BlockCache::block* BlockCache::lookup_or_compile(uint16_t addr) {
+        if ((addr & 1) || addr > MAX_MEMORY - 2) {
+            return nullptr;
+        }
+        if (auto& b = by_address[addr >> 1]; b) {
+            return b.get();
+        }
+        if (rewrites[addr >> 1] >= max_rewrites) {
+            return nullptr;
+        }
+        return compile(addr);
+    }
+
+    size_t BlockCache::run_block(const block& b, size_t count) {
+        const auto* ins = b.ops.data();
+
+        // usually no timer tick is due before any of these instructions, and nothing in the
+        // block can tell the cycle count is only caught up afterwards
+        if (chip.timer_event >= chip.cycle_count + count) {
+            auto ran = chip.execute_all(ins, count);
+            chip.cycle_count += ran;
+            return ran;
+        }
+
+        // otherwise run the first instruction's events now, and catch up on the rest
+        // before each instruction that looks at the timers, then at the end
+        chip.run_events();
+
+        size_t done = 0;
+
+        for (auto t : b.timed) {
+            if (t >= count) {
+                break;
+            }
+            auto ran = chip.execute_all(ins + done, t - done);
+            chip.advance(ran);
+            done += ran;
+
+            // left the block before getting there
+            if (done < t) {
+                return done;
+            }
+            chip.run_events();
+        }
+
+        auto ran = chip.execute_all(ins + done, count - done);
+        chip.advance(ran);
+
+        return done + ran;
+    }
+
+    size_t BlockCache::run(size_t cycles) {
+        size_t executed = 0;
+
+        while (executed < cycles) {
+            if (!pending.empty() || pending_flush) {
+                apply_invalidations();
+            }
+
+            // blocks never span a breakpoint, so this is the only place to check.
+            // the one we start on has already been hit
+            if (executed > 0 && chip.breakpoints != nullptr &&
+                (*chip.breakpoints)[chip.PC & (MAX_MEMORY - 1)]) {
+                break;
+            }
+
+            auto b = lookup_or_compile(chip.PC);
+
+            // misaligned or often rewritten code, interpret it until control flow goes
+            // somewhere else rather than coming back here every instruction
+            if (b == nullptr) {
+                uint16_t from;
+                do {
+                    from = chip.PC;
+                    chip.step();
+                    executed++;
+                } while (executed < cycles && chip.PC == static_cast<uint16_t>(from + 2) &&
+                         !(chip.breakpoints != nullptr &&
+                           (*chip.breakpoints)[chip.PC & (MAX_MEMORY - 1)]));
+                continue;
+            }
+
+            auto count = std::min(b->ops.size(), cycles - executed);
+
+            executed += run_block(*b, count);
+            b->runs++;
+        }
+
+        return executed;
+    }
+
+    bool BlockCache::still_fits(const block& b, uint16_t addr) const noexcept {
+        // the ops point at the decoded cache, which is already up to date, and where control
+        // leaves is found out as the block runs. all that can go stale is which of its
+        // instructions are timed, and where it was split at breakpoints
+        uint16_t aligned = addr & ~1;
+        size_t   index   = (aligned - b.start) / 2;
+
+        if (index == 0) {
+            return true;
+        }
+        if (chip.breakpoints != nullptr && (*chip.breakpoints)[aligned]) {
+            return false;
+        }
+
+        bool was_timed = std::find(b.timed.begin(), b.timed.end(), index) != b.timed.end();
+        return was_timed == uses_timers(b.ops[index]->operation);
+    }
+
+    void BlockCache::apply_invalidations() noexcept {
+        // a block starting at s covers up to s + 2 * max_block_length - 1
+        constexpr uint16_t reach = 2 * max_block_length - 1;
+
+        if (pending_flush) {
+            drop_blocks();
+            return;
+        }
+
+        for (auto [addr, len] : pending) {
+            for (uint16_t i = 0; i < len; ++i) {
+                uint16_t a = (addr + i) & (MAX_MEMORY - 1);
+
+                // every block that could cover a starts at most reach bytes before it
+                uint16_t lowest = a > reach ? a - reach : 0;
+                for (int s = a & ~1; s >= lowest; s -= 2) {
+                    auto& b = by_address[s >> 1];
+                    if (b && b->end > a && !still_fits(*b, a)) {
+                        auto& r = rewrites[s >> 1];
+                        r       = b->runs >= min_runs ? 0 : std::min<uint8_t>(r + 1, max_rewrites);
+                        b.reset();
+                    }
+                }
+            }
+        }
+        pending.clear();
+    }
+
+    void BlockCache::invalidate(uint16_t addr, uint16_t len) noexcept {
+        // the decoded cache is already up to date, so for most writes there's nothing to do
+        for (uint16_t i = 0; i < len; ++i) {
+            uint16_t aligned = (addr + i) & (MAX_MEMORY - 2);
+            bool     timed   = uses_timers(chip.decoded[aligned >> 1].operation);
+
+            if (timed_at[aligned >> 1] != timed) {
+                timed_at[aligned >> 1] = timed;
+                queue(aligned, 2);
+            }
+        }
+    }
+
+    void BlockCache::breakpoint_changed(uint16_t addr) noexcept { queue(addr, 1); }
+
+    void BlockCache::queue(uint16_t addr, uint16_t len) noexcept {
+        if (pending.size() >= max_pending) {
+            pending_flush = true;
+            pending.clear();
+        }
+        if (!pending_flush) {
+            pending.emplace_back(addr, len);
+        }
+    }
+
+    void BlockCache::drop_blocks() noexcept {
+        for (auto& b : by_address) {
+            b.reset();
+        }
+        pending.clear();
+        pending_flush = false;
+    }
+
+    void BlockCache::flush() noexcept {
+        drop_blocks();
+        rewrites = {};
+    }
+} // namespace core
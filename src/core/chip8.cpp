@@ -1,11 +1,14 @@
 #include <iostream>
-#include <bitset>
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <fstream>
-#include <ctime>
+#include <chrono>
 #include <thread>
 #include <future>
 #include "core/chip8.hpp"
-#include "core/bytes.hpp"
+#include "core/jit.hpp"
+#include "core/blockcache.hpp"
 
 const uint8_t fontset[] = {
     0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
@@ -26,14 +29,91 @@ const uint8_t fontset[] = {
     0xF0, 0x80, 0xF0, 0x80, 0x80 // F
 };
 
+// every op, in the same order as the op enum, for building dispatch tables
+#define CHIP8_OPS(X) \
+    X(UNKNOWN)       \
+    X(SYS)           \
+    X(CLS)           \
+    X(RET)           \
+    X(JP)            \
+    X(CALL)          \
+    X(SE_I)          \
+    X(SNE_I)         \
+    X(SE_R)          \
+    X(LD_I)          \
+    X(ADD_I)         \
+    X(LD_R)          \
+    X(OR)            \
+    X(AND)           \
+    X(XOR)           \
+    X(ADD_R)         \
+    X(SUB)           \
+    X(SHR)           \
+    X(SUBN)          \
+    X(SHL)           \
+    X(SNE_R)         \
+    X(LD_I2)         \
+    X(JP_V0)         \
+    X(RND)           \
+    X(DRW)           \
+    X(SKP)           \
+    X(SKNP)          \
+    X(LD_DT)         \
+    X(LD_K)          \
+    X(LD_DT2)        \
+    X(LD_ST)         \
+    X(ADD_I2)        \
+    X(LD_F)          \
+    X(LD_B)          \
+    X(DUMP)          \
+    X(LOAD)
+
+namespace {
+    constexpr op op_order[] = {
+#define X(name) op::name,
+        CHIP8_OPS(X)
+#undef X
+    };
+
+    constexpr bool ops_in_order() {
+        for (size_t i = 0; i < std::size(op_order); ++i) {
+            if (static_cast<size_t>(op_order[i]) != i) {
+                return false;
+            }
+        }
+        return std::size(op_order) == static_cast<size_t>(op::LOAD) + 1;
+    }
+
+    static_assert(ops_in_order(), "CHIP8_OPS must list every op in enum order");
+
+    // execute_all stops after these if PC went anywhere but the next instruction
+    constexpr bool may_jump(op o) {
+        return o == op::SYS || o == op::RET || o == op::JP || o == op::CALL || o == op::SE_I ||
+               o == op::SNE_I || o == op::SE_R || o == op::SNE_R || o == op::JP_V0 ||
+               o == op::SKP || o == op::SKNP || o == op::LD_K;
+    }
+
+    // and always after these, they may have rewritten the instructions after them
+    constexpr bool writes_memory(op o) { return o == op::LD_B || o == op::DUMP; }
+} // namespace
+
 namespace core {
     Chip8::Chip8() : stack(16) {
-        std::srand(std::time(nullptr));
+        // a different sequence every time the emulator is started, unless seeded
+        seed(static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count()));
         copy_font_data();
 
         is_ready = false;
     }
 
+    // out of line, Jit is incomplete in the header
+    Chip8::~Chip8() = default;
+
+    void Chip8::seed(uint64_t value) noexcept {
+        rng_seed = value;
+        rng.seed(value);
+    }
+
     void Chip8::copy_font_data() noexcept {
         for (auto i = 0; i < 80; ++i) {
             memory[i] = fontset[i];
@@ -47,9 +127,11 @@ namespace core {
         framebuffer = {};
         memory      = {};
         V           = {};
-        val         = {};
+        decoded     = {};
         keys        = {};
 
+        framebuffer_generation++;
+
         while (!stack.empty()) {
             stack.pop_back();
         }
@@ -57,198 +139,115 @@ namespace core {
         I  = 0;
         PC = 0;
 
-        cycle_count = 0;
-        delay_timer = 0;
-        sound_timer = 0;
-    }
-
-    uint16_t Chip8::fetch(uint16_t addr) {
+        cycle_count   = 0;
+        waited_cycles = 0;
+        timer_event   = first_timer_event;
+        delay_timer   = 0;
+        sound_timer   = 0;
 
-        auto code = *reinterpret_cast<uint16_t*>(&memory[addr]);
+        rng.seed(rng_seed);
 
-        // CHIP8 is big endian, swap byte order
-        code = swap_byte_order(code);
+        sound_event_count = 0;
 
-        return code;
+        if (jit) {
+            jit->flush();
+        }
+        if (block_cache) {
+            block_cache->flush();
+        }
     }
 
-    op Chip8::decode(uint16_t opc) {
+    uint16_t Chip8::fetch(uint16_t addr) {
+        // big endian. PC can be odd, or past 4KB after JP_V0, so both bytes wrap
+        return static_cast<uint16_t>(memory[addr & 0xFFF] << 8 | memory[(addr + 1) & 0xFFF]);
+    }
 
-        // store each 4 bits of opcode into array
-        for (auto i = 0; i < 4; ++i) {
-            val[i] = (opc >> (4 * (3 - i))) & 0xF;
+    void Chip8::predecode() noexcept {
+        for (size_t i = 0; i < decoded.size(); ++i) {
+            decoded[i] = Decoded(fetch(static_cast<uint16_t>(i * 2)));
         }
+    }
 
-        switch (val[0]) {
-        case 0x0: {
-            if (val[3] == 0xE)
-                return op::RET;
-            else if (val[2] == 0xE)
-                return op::CLS;
-            else
-                return op::SYS;
-        }
-        case 0x1: {
-            return op::JP;
-        }
-        case 0x2: {
-            return op::CALL;
-        }
-        case 0x3: {
-            return op::SE_I;
-        }
-        case 0x4: {
-            return op::SNE_I;
-        }
-        case 0x5: {
-            return op::SE_R;
-        }
-        case 0x6: {
-            return op::LD_I;
-        }
-        case 0x7: {
-            return op::ADD_I;
-        }
-        case 0x8: {
-            switch (val[3]) {
-            case 0x0: {
-                return op::LD_R;
-            }
-            case 0x1: {
-                return op::OR;
-            }
-            case 0x2: {
-                return op::AND;
-            }
-            case 0x3: {
-                return op::XOR;
-            }
-            case 0x4: {
-                return op::ADD_R;
-            }
-            case 0x5: {
-                return op::SUB;
-            }
-            case 0x6: {
-                return op::SHR;
-            }
-            case 0x7: {
-                return op::SUBN;
-            }
-            case 0xE: {
-                return op::SHL;
-            }
-            default: {
-                return op::UNKNOWN;
-            }
-            }
-            break;
+    void Chip8::refresh_decoded(uint16_t addr, uint16_t len) noexcept {
+        // a byte at an odd address is the low half of the instruction before it
+        for (uint16_t i = 0; i < len; ++i) {
+            uint16_t aligned = (addr + i) & 0xFFE;
+
+            decoded[aligned >> 1] = Decoded(fetch(aligned));
         }
-        case 0x9: {
-            return op::SNE_R;
+
+        if (jit) {
+            jit->invalidate(addr, len);
         }
-        case 0xA: {
-            return op::LD_I2;
+        if (block_cache) {
+            block_cache->invalidate(addr, len);
         }
-        case 0xB: {
-            return op::JP_V0;
+    }
+
+    void Chip8::breakpoint_changed(uint16_t addr) noexcept {
+        // blocks are split at breakpoints, so the ones covering addr need rebuilding
+        if (block_cache) {
+            block_cache->breakpoint_changed(addr);
         }
-        case 0xC: {
-            return op::RND;
+    }
+
+    void Chip8::run_events() noexcept {
+        if (cycle_count == timer_event) {
+            update_timers();
+            timer_event += cycles_per_tick;
         }
-        case 0xD: {
-            return op::DRW;
+    }
+
+    void Chip8::advance(size_t cycles) noexcept {
+        cycle_count += cycles;
+
+        while (timer_event < cycle_count) {
+            update_timers();
+            timer_event += cycles_per_tick;
         }
-        case 0xE: {
-            switch (val[3]) {
-            case 0xE: {
-                return op::SKP;
-            }
-            case 0x1: {
-                return op::SKNP;
-            }
-            default: {
-                return op::UNKNOWN;
-            }
-            }
-            break;
+    }
+
+    bool Chip8::waiting_for_key() const noexcept {
+        if ((PC & 1) || decoded[(PC & 0xFFF) >> 1].operation != op::LD_K) {
+            return false;
         }
-        case 0xF: {
-            switch (val[3]) {
-            case 0x7: {
-                return op::LD_DT;
-            }
-            case 0xA: {
-                return op::LD_K;
-            }
-            case 0x8: {
-                return op::LD_ST;
-            }
-            case 0xE: {
-                return op::ADD_I2;
-            }
-            case 0x9: {
-                return op::LD_F;
-            }
-            case 0x3: {
-                return op::LD_B;
-            }
-            case 0x5: {
-                switch (val[2]) {
-                case 0x1: {
-                    return op::LD_DT2;
-                }
-                case 0x5: {
-                    return op::DUMP;
-                }
-                case 0x6: {
-                    return op::LOAD;
-                }
-                default: {
-                    return op::UNKNOWN;
-                }
-                }
-                break;
-            }
-            default: {
-                return op::UNKNOWN;
+        for (auto key : keys) {
+            if (key) {
+                return false;
             }
-            }
-            break;
-        }
         }
-        return op::UNKNOWN;
+        return true;
     }
 
-    void Chip8::execute() {
+    void Chip8::write_memory(uint16_t addr, uint8_t value) noexcept {
+        memory[addr & 0xFFF] = value;
+        refresh_decoded(addr);
+    }
+
+    // the semantics of every instruction, instantiated once per op so each dispatch
+    // backend below gets its own copy with no inner switch left
+    template<op O>
+    void Chip8::exec(const Decoded& ins) {
         // immediates commonly used
-        auto imm4  = opcode & 0xF;
-        auto imm8  = opcode & 0xFF;
-        auto imm12 = opcode & 0xFFF;
+        [[maybe_unused]] auto imm4  = ins.n;
+        [[maybe_unused]] auto imm8  = ins.nn;
+        [[maybe_unused]] auto imm12 = ins.nnn;
 
         // references to typical Vx, Vy parameters
-        auto& Vx = V[val[1]];
-        auto& Vy = V[val[2]];
+        [[maybe_unused]] auto& Vx = V[ins.x];
+        [[maybe_unused]] auto& Vy = V[ins.y];
 
-        switch (operation) {
-            // for call/jump instructions, we unconditionally add 2 to PC every cycle
-            // so by adjusting by -2, we can skip a conditional check
-        case op::SYS: {
+        // for call/jump instructions, we unconditionally add 2 to PC every cycle
+        // so by adjusting by -2, we can skip a conditional check
+        if constexpr (O == op::SYS) {
             stack.emplace_back(PC);
             PC = (imm12)-2;
-            break;
         }
-        case op::CLS: {
-
-            for (auto& line : framebuffer) {
-                for (auto& pixel : line) {
-                    pixel = false;
-                }
-            }
-
-            break;
+        else if constexpr (O == op::CLS) {
+            framebuffer = {};
+            framebuffer_generation++;
         }
-        case op::RET: {
+        else if constexpr (O == op::RET) {
             // get last PC from stack
 
             PC = stack.back();
@@ -257,61 +256,49 @@ namespace core {
             increment anyway
          */
             stack.pop_back();
-            break;
         }
-        case op::JP: {
+        else if constexpr (O == op::JP) {
             PC = (imm12)-2;
-            break;
         }
-        case op::CALL: {
+        else if constexpr (O == op::CALL) {
             // save PC
             stack.emplace_back(PC);
             PC = (imm12)-2;
-            break;
         }
-        case op::SE_I: {
+        else if constexpr (O == op::SE_I) {
             if (Vx == imm8) {
                 PC += 2;
             }
-            break;
         }
-        case op::SNE_I: {
+        else if constexpr (O == op::SNE_I) {
             if (Vx != imm8) {
                 PC += 2;
             }
-            break;
         }
-        case op::SE_R: {
+        else if constexpr (O == op::SE_R) {
             if (Vx == Vy) {
                 PC += 2;
             }
-            break;
         }
-        case op::LD_I: {
+        else if constexpr (O == op::LD_I) {
             Vx = imm8;
-            break;
         }
-        case op::ADD_I: {
+        else if constexpr (O == op::ADD_I) {
             Vx += imm8;
-            break;
         }
-        case op::LD_R: {
+        else if constexpr (O == op::LD_R) {
             Vx = Vy;
-            break;
         }
-        case op::OR: {
+        else if constexpr (O == op::OR) {
             Vx |= Vy;
-            break;
         }
-        case op::AND: {
+        else if constexpr (O == op::AND) {
             Vx &= Vy;
-            break;
         }
-        case op::XOR: {
+        else if constexpr (O == op::XOR) {
             Vx ^= Vy;
-            break;
         }
-        case op::ADD_R: {
+        else if constexpr (O == op::ADD_R) {
 
             auto original = Vx;
             Vx += Vy;
@@ -322,9 +309,8 @@ namespace core {
             else {
                 V[0xF] = 1;
             }
-            break;
         }
-        case op::SUB: {
+        else if constexpr (O == op::SUB) {
             if (Vx > Vy) {
                 V[0xF] = 1;
             }
@@ -332,14 +318,12 @@ namespace core {
                 V[0xF] = 0;
             }
             Vx -= Vy;
-            break;
         }
-        case op::SHR: {
+        else if constexpr (O == op::SHR) {
             V[0xF] = Vx & 0x1;
             Vx >>= 1;
-            break;
         }
-        case op::SUBN: {
+        else if constexpr (O == op::SUBN) {
             if (Vy > Vx) {
                 V[0xF] = 1;
             }
@@ -347,33 +331,26 @@ namespace core {
                 V[0xF] = 0;
             }
             Vx = Vy - Vx;
-            break;
         }
-        case op::SHL: {
+        else if constexpr (O == op::SHL) {
             V[0xF] = Vx >> 7;
             Vx <<= 1;
-            break;
         }
-        case op::SNE_R: {
+        else if constexpr (O == op::SNE_R) {
             if (Vx != Vy) {
                 PC += 2;
             }
-            break;
         }
-        case op::LD_I2: {
+        else if constexpr (O == op::LD_I2) {
             I = imm12;
-            break;
         }
-        case op::JP_V0: {
+        else if constexpr (O == op::JP_V0) {
             PC = V[0x0] + imm12;
-            break;
         }
-        case op::RND: {
-            uint8_t r = std::rand() & 0xFF;
-            Vx        = r & imm8;
-            break;
+        else if constexpr (O == op::RND) {
+            Vx = rng.next_byte() & imm8;
         }
-        case op::DRW: {
+        else if constexpr (O == op::DRW) {
 
             auto x = Vx;
             auto y = Vy;
@@ -382,109 +359,388 @@ namespace core {
             if (n == 0)
                 n = 16;
 
-            bool pixel_unset = false;
+            uint64_t collisions = 0;
 
-            // N lines down
+            // N lines down. the sprite line goes in the top byte, then rotates right
+            // into place, wrapping around the right edge
             for (uint8_t i = 0; i < n; ++i) {
-                std::bitset<8> line = memory[I + i];
+                uint64_t line = std::rotr(static_cast<uint64_t>(memory[(I + i) & 0xFFF]) << 56,
+                                          x % X_PIXELS);
 
-                uint8_t currY = (y + i) % Y_PIXELS;
+                auto& row = framebuffer[(y + i) % Y_PIXELS];
 
-                // 8 pixels per line, to right
-                for (uint8_t j = 0; j < 8; ++j) {
-
-                    uint8_t currX = (x + j) % X_PIXELS;
-
-                    // 7 - j because 0 actually is least significant bit
-                    if (!pixel_unset && framebuffer[currY][currX] && line[7 - j]) {
-                        pixel_unset = true;
-                    }
-                    framebuffer[currY][currX] ^= line[7 - j];
-                }
+                collisions |= row & line;
+                row ^= line;
             }
 
-            if (pixel_unset)
-                V[0xF] = 1;
-            else
-                V[0xF] = 0;
+            V[0xF] = collisions != 0;
+
+            framebuffer_generation++;
 
-            break;
         }
-        case op::SKP: {
-            if (keys[Vx]) {
+        else if constexpr (O == op::SKP) {
+            if (keys[Vx & 0xF]) {
                 PC += 2;
             }
-            break;
         }
-        case op::SKNP: {
-            if (!keys[Vx]) {
+        else if constexpr (O == op::SKNP) {
+            if (!keys[Vx & 0xF]) {
                 PC += 2;
             }
-            break;
         }
-        case op::LD_DT: {
+        else if constexpr (O == op::LD_DT) {
             Vx = delay_timer;
-            break;
         }
-        case op::LD_K: {
+        else if constexpr (O == op::LD_K) {
             bool wait = true;
-            while (wait) {
-
-                for (auto i = 0; i < 16; ++i) {
-                    if (keys[i]) {
-                        Vx   = static_cast<uint8_t>(i);
-                        wait = false;
-                        break;
-                    }
+
+            for (auto i = 0; i < 16; ++i) {
+                if (keys[i]) {
+                    Vx   = static_cast<uint8_t>(i);
+                    wait = false;
+                    break;
                 }
             }
-            break;
+            // no key yet, run this instruction again next cycle instead of spinning here,
+            // keys are only ever updated from outside of execute(). see waiting_for_key()
+            // for how the schedulers avoid doing that thousands of times
+            if (wait) {
+                PC -= 2;
+            }
         }
-        case op::LD_DT2: {
+        else if constexpr (O == op::LD_DT2) {
             delay_timer = Vx;
-            break;
         }
-        case op::LD_ST: {
+        else if constexpr (O == op::LD_ST) {
+            if ((sound_timer == 0) != (Vx == 0)) {
+                sound_changed(cycle_count, Vx != 0);
+            }
             sound_timer = Vx;
-            break;
         }
-        case op::ADD_I2: {
+        else if constexpr (O == op::ADD_I2) {
             I += Vx;
-            break;
         }
-        case op::LD_F: {
+        else if constexpr (O == op::LD_F) {
             uint8_t c = Vx;
             I         = c * 5;
-            break;
         }
-        case op::LD_B: {
+        else if constexpr (O == op::LD_B) {
             uint8_t first  = Vx / 100;
             uint8_t second = (Vx / 10) % 10;
             uint8_t third  = Vx % 10;
 
-            memory[I]     = (first);
-            memory[I + 1] = (second);
-            memory[I + 2] = (third);
-            break;
+            // I can be anything after ADD_I2, wrap like sprite reads and refresh_decoded do
+            memory[I & 0xFFF]       = (first);
+            memory[(I + 1) & 0xFFF] = (second);
+            memory[(I + 2) & 0xFFF] = (third);
+
+            refresh_decoded(I & 0xFFF, 3);
         }
-        case op::DUMP: {
-            auto ptr = I;
-            for (auto i = 0; i <= val[1]; ++i) {
-                memory[ptr++] = (V[i]);
+        else if constexpr (O == op::DUMP) {
+            for (auto i = 0; i <= ins.x; ++i) {
+                memory[(I + i) & 0xFFF] = (V[i]);
             }
-            break;
+
+            refresh_decoded(I & 0xFFF, ins.x + 1);
+        }
+        else if constexpr (O == op::LOAD) {
+            for (auto i = 0; i <= ins.x; ++i) {
+                V[i] = static_cast<uint8_t>(memory[(I + i) & 0xFFF]);
+            }
+        }
+        else if constexpr (O == op::UNKNOWN) {
+            std::cout << "Unknown opcode: " << std::hex << ins.opcode << '\n';
+        }
+
+    }
+
+    // plain switch dispatch, always used for single steps
+    void Chip8::execute(const Decoded& ins) {
+        switch (ins.operation) {
+#define X(name)                      \
+    case op::name: {                 \
+        exec<op::name>(ins);         \
+        break;                       \
+    }
+            CHIP8_OPS(X)
+#undef X
+        }
+    }
+
+    const Decoded& Chip8::current() noexcept {
+        // fetch and decode, from the cache unless PC is misaligned
+        if (PC & 1) {
+            misaligned = Decoded(fetch(PC));
+            return misaligned;
+        }
+        return decoded[(PC & 0xFFF) >> 1];
+    }
+
+    void Chip8::run_switch(size_t cycles) {
+        for (size_t i = 0; i < cycles; ++i) {
+            step();
+        }
+    }
+
+    // one handler per op, indexed by op. each handler is a plain function with exec<>
+    // inlined into it, so a cycle is a single indirect call. a pointer to member would
+    // add a check for virtual functions and an adjustment of this to every call
+    Chip8::handler Chip8::handler_for(op o) noexcept {
+        static constexpr handler handlers[] = {
+#define X(name) [](Chip8& c, const Decoded& ins) { c.exec<op::name>(ins); },
+            CHIP8_OPS(X)
+#undef X
+        };
+
+        return handlers[static_cast<size_t>(o)];
+    }
+
+    void Chip8::run_table(size_t cycles) {
+        for (size_t i = 0; i < cycles; ++i) {
+            run_events();
+
+            // the aligned fetch inline, current() is a call of its own
+            const auto& ins = (PC & 1) ? current() : decoded[(PC & 0xFFF) >> 1];
+            handler_for(ins.operation)(*this, ins);
+
+            PC += 2;
+            cycle_count++;
         }
-        case op::LOAD: {
-            auto ptr = I;
-            for (auto i = 0; i <= val[1]; ++i) {
-                V[i] = static_cast<uint8_t>(memory[ptr++]);
+    }
+
+#if CHIP8_HAS_COMPUTED_GOTO
+// labels as values are a GNU extension
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+    // threaded code, the end of every handler jumps straight to the handler of the next
+    // instruction. that gives the branch predictor one indirect jump per op to learn,
+    // rather than a single shared one
+    void Chip8::run_threaded(size_t cycles) {
+        static void* const labels[] = {
+#define X(name) &&op_##name,
+            CHIP8_OPS(X)
+#undef X
+        };
+
+        const Decoded* ins = nullptr;
+
+#define DISPATCH()                                                    \
+    do {                                                              \
+        if (cycles-- == 0) {                                          \
+            return;                                                   \
+        }                                                             \
+        run_events();                                                 \
+        ins = &current();                                             \
+        goto* labels[static_cast<size_t>(ins->operation)];            \
+    } while (0)
+
+        DISPATCH();
+
+#define X(name)              \
+    op_##name:               \
+    exec<op::name>(*ins);    \
+    PC += 2;                 \
+    cycle_count++;           \
+    DISPATCH();
+        CHIP8_OPS(X)
+#undef X
+#undef DISPATCH
+    }
+
+    // threaded like run_threaded, with no timers or cycle count. only the ops that can
+    // jump check where PC went
+    size_t Chip8::execute_all(const Decoded* const* ins, size_t count) {
+        static void* const labels[] = {
+#define X(name) &&op_##name,
+            CHIP8_OPS(X)
+#undef X
+        };
+
+        const auto* begin = ins;
+        const auto* end   = ins + count;
+        uint16_t    next;
+
+#define DISPATCH()                                                    \
+    do {                                                              \
+        if (ins == end) {                                             \
+            return count;                                             \
+        }                                                             \
+        goto* labels[static_cast<size_t>((*ins)->operation)];         \
+    } while (0)
+
+        DISPATCH();
+
+#define X(name)                                                       \
+    op_##name:                                                        \
+    next = static_cast<uint16_t>(PC + 2);                             \
+    exec<op::name>(**ins++);                                          \
+    PC += 2;                                                          \
+    if constexpr (writes_memory(op::name)) {                          \
+        return static_cast<size_t>(ins - begin);                      \
+    }                                                                 \
+    else if constexpr (may_jump(op::name)) {                          \
+        if (PC != next) {                                             \
+            return static_cast<size_t>(ins - begin);                  \
+        }                                                             \
+    }                                                                 \
+    DISPATCH();
+        CHIP8_OPS(X)
+#undef X
+#undef DISPATCH
+    }
+
+#pragma GCC diagnostic pop
+#else
+    size_t Chip8::execute_all(const Decoded* const* ins, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            auto next = static_cast<uint16_t>(PC + 2);
+
+            execute(*ins[i]);
+            PC += 2;
+
+            if (PC != next || writes_memory(ins[i]->operation)) {
+                return i + 1;
             }
+        }
+        return count;
+    }
+#endif
+
+    bool Chip8::skip_key_wait(size_t cycles) noexcept {
+        // keys only change between batches, so LD_K can't finish inside this one. skip
+        // straight to the end of it rather than executing it over and over
+        if (!waiting_for_key()) {
+            return false;
+        }
+        advance(cycles);
+        waited_cycles += cycles;
+        return true;
+    }
+
+    size_t Chip8::run_blocks(size_t cycles) {
+        if (!block_cache) {
+            block_cache = std::make_unique<BlockCache>(*this);
+        }
+        return block_cache->run(cycles);
+    }
+
+    size_t Chip8::run_to_breakpoint(size_t cycles) {
+        if (skip_key_wait(cycles)) {
+            return cycles;
+        }
+        return run_blocks(cycles);
+    }
+
+    size_t Chip8::run_for(size_t cycles) {
+        if (skip_key_wait(cycles)) {
+            return cycles;
+        }
+
+        switch (dispatch) {
+        case backend::switch_dispatch: {
+            run_switch(cycles);
+            break;
+        }
+        case backend::table_dispatch: {
+            run_table(cycles);
+            break;
+        }
+        case backend::threaded_dispatch: {
+#if CHIP8_HAS_COMPUTED_GOTO
+            run_threaded(cycles);
+#else
+            run_switch(cycles);
+#endif
             break;
         }
-        case op::UNKNOWN: {
-            std::cout << "Unknown opcode: " << std::hex << opcode << '\n';
+        case backend::jit: {
+#if CHIP8_HAS_JIT
+            if (!jit) {
+                jit = std::make_unique<Jit>(*this);
+            }
+            if (jit->usable()) {
+                jit->run(cycles);
+                break;
+            }
+#endif
+            run_switch(cycles);
             break;
         }
+        case backend::block_dispatch: {
+            return run_blocks(cycles);
+        }
+        }
+        return cycles;
+    }
+
+    bool Chip8::save_state(MachineState& out) const noexcept {
+        if (stack.size() > out.stack.size()) {
+            return false;
+        }
+
+        out.memory      = memory;
+        out.framebuffer = framebuffer;
+        out.V           = V;
+
+        out.stack_size = static_cast<uint8_t>(stack.size());
+        std::copy(stack.cbegin(), stack.cend(), out.stack.begin());
+
+        out.I           = I;
+        out.PC          = PC;
+        out.delay_timer = delay_timer;
+        out.sound_timer = sound_timer;
+        out.keys        = keys;
+        out.cycle_count = cycle_count;
+        out.timer_event = timer_event;
+
+        out.cycles_per_tick = cycles_per_tick;
+        out.rng             = rng.state;
+
+        return true;
+    }
+
+    void Chip8::load_state(const MachineState& in) noexcept {
+        // compare a chunk at a time, programs rarely write more than a few bytes a frame
+        constexpr uint16_t chunk = 64;
+
+        for (uint16_t addr = 0; addr < MAX_MEMORY; addr += chunk) {
+            if (std::memcmp(&memory[addr], &in.memory[addr], chunk) != 0) {
+                std::memcpy(&memory[addr], &in.memory[addr], chunk);
+                refresh_decoded(addr, chunk);
+            }
+        }
+
+        if (framebuffer != in.framebuffer) {
+            framebuffer = in.framebuffer;
+            framebuffer_generation++;
+        }
+
+        V = in.V;
+
+        while (!stack.empty()) {
+            stack.pop_back();
+        }
+        for (uint8_t i = 0; i < std::min<uint8_t>(in.stack_size, 16); ++i) {
+            stack.push_back(in.stack[i]);
+        }
+
+        I           = in.I;
+        PC          = in.PC;
+        delay_timer = in.delay_timer;
+        sound_timer = in.sound_timer;
+        keys        = in.keys;
+        cycle_count = in.cycle_count;
+        timer_event = in.timer_event;
+
+        cycles_per_tick = std::max<size_t>(in.cycles_per_tick, 1);
+
+        // all zeros would make RND return 0 forever
+        if (in.rng == std::array<uint64_t, 4>{}) {
+            rng.seed(rng_seed);
+        }
+        else {
+            rng.state = in.rng;
         }
     }
 
@@ -494,25 +750,28 @@ namespace core {
         }
         if (sound_timer > 0) {
             sound_timer--;
+
+            // ticks only ever happen on timer_event
+            if (sound_timer == 0) {
+                sound_changed(timer_event, false);
+            }
         }
     }
 
-    void Chip8::cycle() {
-
-        // 600Hz
-        while (!timer.update())
-            ;
-
-        if (cycle_count % 10 == 1) {
-            update_timers();
+    void Chip8::sound_changed(size_t cycle, bool on) noexcept {
+        if (sound_event_count == sound_events.size()) {
+            return;
         }
+        if (sound_event_count > 0) {
+            cycle = std::max(cycle, sound_events[sound_event_count - 1].cycle);
+        }
+        sound_events[sound_event_count++] = { cycle, on };
+    }
+
+    void Chip8::step() {
+        run_events();
 
-        // fetch
-        opcode = fetch(PC);
-        // decode
-        operation = decode(opcode);
-        // execute
-        execute();
+        execute(current());
 
         PC += 2;
 
@@ -1,53 +1,79 @@
 #include "core/emuwrapper.hpp"
 #include "core/opcodes.hpp"
+#include "core/savestate.hpp"
 #include <unordered_map>
 #include <iostream>
 #include <fmt/ranges.h>
 #include <thread>
 #include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <utility>
 
 namespace {
 
-    void read_file(const std::string& name, uint16_t addr, uint8_t* data) {
+    // returns false if file couldn't be opened. anything past end of memory is dropped
+    bool read_file(const std::string& name, uint16_t addr, uint8_t* data) {
         std::ifstream file;
         file.open(name, std::ios_base::binary);
+        if (!file.is_open() || addr >= MAX_MEMORY) {
+            return false;
+        }
         file.seekg(0, std::ios::end);
         size_t size = file.tellg();
         file.seekg(0, std::ios::beg);
-        file.read(reinterpret_cast<char*>(data + addr), size);
+        file.read(reinterpret_cast<char*>(data + addr), std::min<size_t>(size, MAX_MEMORY - addr));
         file.close();
+        return true;
     }
 } // namespace
 
 namespace core {
-    EmuWrapper::EmuWrapper() = default;
+    EmuWrapper::EmuWrapper() { proc.breakpoints = &breakpoints; }
 
     void EmuWrapper::new_game(const std::string& filepath, uint16_t entry, uint16_t addr,
                               bool paused) {
-        using namespace std::chrono_literals;
-
         emu_paused = paused;
 
-        proc.is_ready = false;
-        std::this_thread::sleep_for(100ms);
+        load_rom(filepath, entry, addr);
 
+        if (paused) {
+            pause();
+        }
+    }
+
+    bool EmuWrapper::load_rom(const std::string& filepath, uint16_t entry, uint16_t addr) {
+        drop_run_ahead();
+        history.clear();
         proc.reset_state();
         proc.PC = entry;
-        read_file(filepath, addr, proc.memory.data());
+        bool ret = read_file(filepath, addr, proc.memory.data());
 
         proc.copy_font_data();
+        proc.predecode();
 
         proc.base_address = addr;
         proc.entry_point  = entry;
 
         proc.is_ready = true;
+
+        restart_timeline();
+
+        return ret;
+    }
+
+    size_t EmuWrapper::run_for(size_t cycles) noexcept {
+        return proc.run_for(cycles);
     }
 
-    std::array<std::array<bool, X_PIXELS>, Y_PIXELS>& EmuWrapper::frame_buffer() noexcept {
+    void    EmuWrapper::set_backend(backend b) noexcept { proc.dispatch = b; }
+    backend EmuWrapper::get_backend() const noexcept { return proc.dispatch; }
+
+    Framebuffer& EmuWrapper::frame_buffer() noexcept {
         return proc.framebuffer;
     }
 
-    // save current emu state
+    // remember what was last published
     void EmuWrapper::save_emu_state() noexcept {
         prev_V      = proc.V;
         prev_memory = proc.memory;
@@ -57,35 +83,97 @@ namespace core {
         prev_st     = proc.sound_timer;
     }
 
-    // update changed registers etc
-    void EmuWrapper::update_state() noexcept {
+    void EmuWrapper::publish_snapshot() noexcept {
+        auto& s = snapshots.write_buffer();
+
+        s.version     = ++snapshot_version;
+        s.cycle_count = proc.cycle_count;
+
+        s.V           = proc.V;
+        s.I           = proc.I;
+        s.PC          = proc.PC;
+        s.delay_timer = proc.delay_timer;
+        s.sound_timer = proc.sound_timer;
+
         for (auto i = 0; i < 16; ++i) {
-            reg_changes[i] = (prev_V[i] != proc.V[i]);
+            s.V_changed[i] = (prev_V[i] != proc.V[i]);
         }
 
-        I_change  = (prev_I != proc.I);
-        PC_change = (prev_PC != proc.PC);
-        dt_change = (prev_dt != proc.delay_timer);
-        st_change = (prev_st != proc.sound_timer);
-    }
+        s.I_changed  = (prev_I != proc.I);
+        s.PC_changed = (prev_PC != proc.PC);
+        s.dt_changed = (prev_dt != proc.delay_timer);
+        s.st_changed = (prev_st != proc.sound_timer);
 
-    void EmuWrapper::set_destination(uint16_t addr) noexcept {
-        destination = addr;
-        debugging   = true;
-    }
+        s.stack_size = proc.stack.size();
+        s.stack      = {};
+        std::copy_n(proc.stack.begin(), std::min<size_t>(s.stack_size, s.stack.size()),
+                    s.stack.begin());
+
+        s.memory = proc.memory;
+        for (size_t i = 0; i < MAX_MEMORY; ++i) {
+            s.memory_changed[i] = (prev_memory[i] != proc.memory[i]);
+        }
+
+        if (ahead_shown) {
+            s.framebuffer            = ahead_framebuffer;
+            s.framebuffer_generation = ahead_generation;
+        }
+        else {
+            s.framebuffer            = proc.framebuffer;
+            s.framebuffer_generation = proc.framebuffer_generation;
+        }
+
+        s.entry_point     = proc.entry_point;
+        s.cycles_per_tick = proc.cycles_per_tick;
+
+        s.input_latency = input_latency;
+
+        s.ready               = is_ready();
+        s.paused              = is_paused();
+        s.debugging           = being_debugged();
+        s.waiting_for_key     = proc.waiting_for_key();
+        s.reached_destination = reached_destination();
+        s.state_failed        = state_failed;
+        s.rewinding           = rewinding;
+        s.rewind_frames       = history.frames();
+        s.can_reverse         = proc.cycle_count > 0 &&
+                              timeline.checkpoint_at(proc.cycle_count - 1) != nullptr;
+
+        snapshots.publish();
 
-    // a debug cycle just wraps around normal cycle and updates debugger's state. reset_timer
-    // will reset the timer on emu, meaning this cycle will happen instantly
-    void EmuWrapper::debug_cycle(bool reset_timer) noexcept {
         save_emu_state();
 
-        if (reset_timer) {
-            proc.timer.reset();
+        publish_sound();
+    }
+
+    void EmuWrapper::publish_sound() noexcept {
+        // with nobody listening the queue fills up, and the rest are dropped
+        for (size_t i = 0; i < proc.sound_event_count; ++i) {
+            sound_queue.push(proc.sound_events[i]);
         }
+        proc.sound_event_count = 0;
+
+        sound_until.store(proc.cycle_count, std::memory_order_release);
+    }
+
+    std::optional<SoundEvent> EmuWrapper::pop_sound_event() noexcept { return sound_queue.pop(); }
+
+    size_t EmuWrapper::sound_horizon() const noexcept {
+        return sound_until.load(std::memory_order_acquire);
+    }
+
+    double EmuWrapper::cycles_per_second() const noexcept {
+        return static_cast<double>(frame_cycles.load(std::memory_order_relaxed)) * 60.0 *
+               speed.load(std::memory_order_relaxed);
+    }
 
-        proc.cycle();
+    bool EmuWrapper::update_snapshot() noexcept { return snapshots.update(); }
 
-        update_state();
+    const Snapshot& EmuWrapper::snapshot() const noexcept { return snapshots.read(); }
+
+    void EmuWrapper::set_destination(uint16_t addr) noexcept {
+        destination = addr;
+        debugging   = true;
     }
 
     void EmuWrapper::get_next_instruction() noexcept {
@@ -96,40 +184,142 @@ namespace core {
         next_operation = decode(next_opcode);
     }
 
-    void EmuWrapper::reset() noexcept {
-        for (auto i = 0; i < 16; ++i) {
-            reg_changes[i] = false;
-        }
-
-        I_change  = false;
-        PC_change = false;
-        dt_change = false;
-        st_change = false;
-    }
-
-    // use a mutex here
     void EmuWrapper::pause() noexcept {
-        using namespace std::chrono_literals;
-
         emu_paused = true;
         debugging  = false;
-        std::this_thread::sleep_for(10ms);
 
-        reset();
+        // the debugger wants to see the real screen
+        drop_run_ahead();
 
         get_next_instruction();
     };
 
     void EmuWrapper::unpause() noexcept {
         emu_paused = false;
-        reset();
+        pacer.reset();
+        frames_owed = 0;
     }
 
     void EmuWrapper::single_step() noexcept {
         if (is_paused()) {
-            debug_cycle(true);
+            apply_input();
+            proc.step();
             set_destination(proc.PC);
+            checkpoint();
+        }
+    }
+
+    void EmuWrapper::checkpoint() noexcept {
+        if (timeline.due(proc.cycle_count) && proc.save_state(checkpoint_state)) {
+            timeline.add_checkpoint(checkpoint_state);
+        }
+    }
+
+    void EmuWrapper::restart_timeline() noexcept {
+        timeline.clear();
+        checkpoint();
+    }
+
+    template<typename F>
+    void EmuWrapper::replay(const MachineState& from, size_t cycle, F&& before_step) noexcept {
+        restore(from, false);
+
+        auto& keys = timeline.keys();
+        auto  next = std::lower_bound(
+                keys.begin(), keys.end(), proc.cycle_count,
+                [](const KeyChange& k, size_t c) { return k.cycle < c; });
+
+        for (;;) {
+            // keys change before the instruction on their cycle runs
+            for (; next != keys.end() && next->cycle <= proc.cycle_count; ++next) {
+                proc.keys = next->keys;
+            }
+            if (proc.cycle_count >= cycle) {
+                break;
+            }
+            before_step();
+            proc.step();
+        }
+    }
+
+    bool EmuWrapper::go_back(size_t cycle) noexcept {
+        auto from = timeline.checkpoint_at(cycle);
+        if (from == nullptr) {
+            return false;
+        }
+        replay(*from, cycle, [] {});
+        return true;
+    }
+
+    void EmuWrapper::finish_reverse(size_t sound_events, bool was_sounding) noexcept {
+        // the sound timer never went back and forth as far as anyone listening is concerned
+        proc.sound_event_count = sound_events;
+        if (was_sounding != (proc.sound_timer > 0)) {
+            proc.sound_changed(proc.cycle_count, proc.sound_timer > 0);
+        }
+
+        // from here the program may go somewhere else
+        timeline.truncate(proc.cycle_count);
+
+        get_next_instruction();
+        set_destination(proc.PC);
+    }
+
+    bool EmuWrapper::reverse_step() noexcept {
+        if (!is_paused() || proc.cycle_count == 0) {
+            return false;
+        }
+
+        auto events   = proc.sound_event_count;
+        bool sounding = proc.sound_timer > 0;
+
+        if (!go_back(proc.cycle_count - 1)) {
+            return false;
+        }
+
+        finish_reverse(events, sounding);
+        return true;
+    }
+
+    bool EmuWrapper::reverse_continue() noexcept {
+        if (!is_paused()) {
+            return false;
         }
+
+        auto events   = proc.sound_event_count;
+        bool sounding = proc.sound_timer > 0;
+
+        // run each interval between checkpoints again, newest first, until one of them
+        // reaches a breakpoint. the last time it does is where we stop
+        auto end = proc.cycle_count;
+        while (end > 0) {
+            auto from = timeline.checkpoint_at(end - 1);
+            if (from == nullptr) {
+                break;
+            }
+            auto start = from->cycle_count;
+
+            std::optional<size_t> hit;
+            replay(*from, end, [&] {
+                if (breakpoints[proc.PC & 0xFFF]) {
+                    hit = proc.cycle_count;
+                }
+            });
+
+            if (hit) {
+                go_back(*hit);
+                finish_reverse(events, sounding);
+                return true;
+            }
+            end = start;
+        }
+
+        // no breakpoint as far back as we can go, stop at the start of it
+        if (end == proc.cycle_count || !go_back(end)) {
+            return false;
+        }
+        finish_reverse(events, sounding);
+        return true;
     }
 
     void EmuWrapper::step_over() noexcept {
@@ -158,19 +348,88 @@ namespace core {
 
     void EmuWrapper::cycle() noexcept {
         // if we hit a breakpoint, we've reached a destination
-        if (breakpoints[proc.PC]) {
+        if (breakpoints[proc.PC & 0xFFF]) {
             destination = proc.PC;
             pause();
         }
         else if (reached_destination()) {
             pause();
         }
-        else if (being_debugged()) {
-            debug_cycle();
+        else {
+            proc.step();
+        }
+    }
+
+    size_t EmuWrapper::run_frame() noexcept {
+        apply_input();
+
+        size_t executed = 0;
+
+        if (rewinding) {
+            // a frame back for every frame that goes by
+            if (history.pop(rewind_state)) {
+                restore(rewind_state, true);
+
+                // what the debugger knows of from here on didn't happen now
+                timeline.truncate(proc.cycle_count);
+                timeline.key_changed(proc.cycle_count, proc.keys);
+            }
         }
         else {
-            proc.cycle();
+            if (stalled()) {
+                publish_snapshot();
+                wait_for_key();
+                return 0;
+            }
+
+            cycle_debt += static_cast<double>(proc.cycles_per_tick) * speed;
+
+            auto cycles = static_cast<size_t>(cycle_debt);
+
+            cycle_debt -= cycles;
+
+            if (being_debugged()) {
+                // stepping over or out, the debugger needs to see every cycle
+                while (executed < cycles && !is_paused()) {
+                    cycle();
+                    executed++;
+                }
+                drop_run_ahead();
+            }
+            else if (breakpoint_count > 0) {
+                // blocks stop short of a breakpoint themselves, only the first instruction
+                // is ours to check, as cycle() would
+                if (!breakpoints[proc.PC & 0xFFF]) {
+                    executed = proc.run_to_breakpoint(cycles);
+                }
+                if (executed < cycles) {
+                    destination = proc.PC;
+                    pause();
+                }
+                drop_run_ahead();
+            }
+            else {
+                executed = proc.run_for(cycles);
+                run_ahead();
+            }
+
+            if (history.enabled() && proc.save_state(rewind_state)) {
+                history.push(rewind_state);
+            }
+            checkpoint();
         }
+
+        publish_snapshot();
+
+        // the next one comes with the next vsync
+        if (display_sync) {
+            return executed;
+        }
+
+        sleep_until(pacer.due());
+        pacer.next();
+
+        return executed;
     }
 
     bool EmuWrapper::reached_destination() const noexcept { return proc.PC == destination; }
@@ -185,22 +444,470 @@ namespace core {
         unpause();
     }
 
-    void EmuWrapper::set_breakpoint(uint16_t addr) noexcept { breakpoints[addr] = true; }
+    bool EmuWrapper::stalled() const noexcept {
+        return proc.waiting_for_key() && proc.delay_timer == 0 && proc.sound_timer == 0;
+    }
+
+    void EmuWrapper::wait_for_key() noexcept {
+        std::unique_lock lock(wake_mutex);
+
+        wake_cv.wait(lock, [this] { return wake_pending || held_key || !key_events.empty(); });
+        wake_pending = false;
+
+        lock.unlock();
+
+        // however long we slept, carry on as if the key came at the start of a frame
+        pacer.reset();
+        frames_owed = display_sync ? 1 : 0;
+    }
+
+    void EmuWrapper::set_key(uint8_t key, bool down) noexcept {
+        KeyEvent e{ static_cast<uint8_t>(key & 0xF), down, std::chrono::steady_clock::now() };
+
+        // same as send, the emulation thread empties the queue every frame
+        while (!key_events.push(e)) {
+            interrupt();
+            std::this_thread::yield();
+        }
+        interrupt();
+    }
+
+    void EmuWrapper::apply_input() noexcept {
+        auto now = std::chrono::steady_clock::now();
+
+        std::array<bool, 16> changed = {};
+
+        for (;;) {
+            auto e = held_key ? std::exchange(held_key, std::nullopt) : key_events.pop();
+            if (!e) {
+                break;
+            }
+            // this key already changed this frame, leave it and everything after it
+            if (changed[e->key]) {
+                held_key = e;
+                break;
+            }
+
+            changed[e->key]   = true;
+            proc.keys[e->key] = e->down;
+            input_latency     = now - e->time;
+        }
+
+        if (std::find(changed.begin(), changed.end(), true) != changed.end()) {
+            timeline.key_changed(proc.cycle_count, proc.keys);
+        }
+    }
+
+    void EmuWrapper::merge_input() noexcept {
+        bool changed = false;
+
+        for (;;) {
+            auto e = held_key ? std::exchange(held_key, std::nullopt) : key_events.pop();
+            if (!e) {
+                break;
+            }
+            changed |= proc.keys[e->key] != e->down;
+            proc.keys[e->key] = e->down;
+        }
+
+        if (changed) {
+            timeline.key_changed(proc.cycle_count, proc.keys);
+        }
+    }
+
+    bool EmuWrapper::is_waiting_for_key() const noexcept { return proc.waiting_for_key(); }
+
+    void EmuWrapper::interrupt() noexcept {
+        {
+            std::lock_guard lock(wake_mutex);
+            wake_pending = true;
+        }
+        wake_cv.notify_one();
+    }
+
+    void EmuWrapper::sleep_until(std::chrono::steady_clock::time_point until) noexcept {
+        std::unique_lock lock(wake_mutex);
+
+        while (wake_cv.wait_until(lock, until, [this] { return wake_pending; })) {
+            wake_pending = false;
+            lock.unlock();
+
+            process_commands();
+            if (is_paused() || !is_ready() || stopping) {
+                return;
+            }
+
+            lock.lock();
+        }
+    }
+
+    void EmuWrapper::idle() noexcept {
+        std::unique_lock lock(wake_mutex);
+
+        wake_cv.wait(lock, [this] { return wake_pending; });
+        wake_pending = false;
+    }
+
+    bool EmuWrapper::run_batch() noexcept {
+        process_commands();
+
+        if (stopping) {
+            return false;
+        }
+
+        if (!is_paused() && is_ready() && !display_sync) {
+            run_frame();
+        }
+        else if (!is_paused() && is_ready() && (frames_owed > 0 || stalled())) {
+            // a frame or two, or more if we've fallen behind. beyond that we drop them
+            // rather than run the game fast to catch up. the GUI stops asking for frames
+            // while we're stalled, so go and wait for the key regardless
+            auto owed = std::clamp<uint32_t>(frames_owed.exchange(0), 1, 4);
+            for (uint32_t i = 0; i < owed && !is_paused() && !stopping; ++i) {
+                run_frame();
+            }
+        }
+        else {
+            if (is_paused() || !is_ready()) {
+                merge_input();
+            }
+            // send, set_key and stop all wake us straight away
+            idle();
+        }
+
+        return !stopping;
+    }
+
+    void EmuWrapper::stop() noexcept {
+        stopping = true;
+        interrupt();
+    }
+
+    uint64_t EmuWrapper::send(Command c) noexcept {
+        // the emulation thread empties the queue within a batch, so a full queue is brief
+        while (!commands.push(std::move(c))) {
+            interrupt();
+            std::this_thread::yield();
+        }
+        interrupt();
+
+        return ++sent;
+    }
+
+    bool EmuWrapper::is_done(uint64_t ticket) const noexcept {
+        return done.load(std::memory_order_acquire) >= ticket;
+    }
+
+    void EmuWrapper::wait_done(uint64_t ticket) const noexcept {
+        for (auto current = done.load(std::memory_order_acquire); current < ticket;
+             current     = done.load(std::memory_order_acquire)) {
+            done.wait(current, std::memory_order_acquire);
+        }
+    }
+
+    bool EmuWrapper::process_commands() noexcept {
+        uint64_t count = 0;
+
+        while (auto c = commands.pop()) {
+            execute(*c);
+            count++;
+        }
+
+        if (count == 0) {
+            return false;
+        }
+
+        // publish before anyone waiting on these hears they're done, so their effects
+        // are in the next snapshot the GUI picks up
+        publish_snapshot();
+
+        done.fetch_add(count, std::memory_order_release);
+        done.notify_all();
+
+        return true;
+    }
+
+    void EmuWrapper::execute(Command& c) noexcept {
+        switch (c.type) {
+        case Command::kind::load_rom: {
+            new_game(c.path, c.entry, c.addr, c.paused);
+            break;
+        }
+        case Command::kind::pause: {
+            pause();
+            break;
+        }
+        case Command::kind::continue_emu: {
+            continue_emu();
+            break;
+        }
+        case Command::kind::single_step: {
+            single_step();
+            break;
+        }
+        case Command::kind::step_over: {
+            step_over();
+            break;
+        }
+        case Command::kind::step_out: {
+            step_out();
+            break;
+        }
+        case Command::kind::clear_destination: {
+            recv_destination();
+            break;
+        }
+        case Command::kind::set_breakpoint: {
+            set_breakpoint(c.addr);
+            break;
+        }
+        case Command::kind::remove_breakpoint: {
+            remove_breakpoint(c.addr);
+            break;
+        }
+        case Command::kind::poke: {
+            write_memory(c.addr, c.value);
+            // replaying from before the write would lose it
+            restart_timeline();
+            break;
+        }
+        case Command::kind::reverse_step: {
+            reverse_step();
+            break;
+        }
+        case Command::kind::reverse_continue: {
+            reverse_continue();
+            break;
+        }
+        case Command::kind::frame_sync: {
+            set_display_sync(c.value != 0);
+            break;
+        }
+        case Command::kind::cycles_per_frame: {
+            set_cycles_per_frame(c.count);
+            break;
+        }
+        case Command::kind::run_ahead: {
+            set_run_ahead(c.count);
+            break;
+        }
+        case Command::kind::rewind_length: {
+            set_rewind_length(c.count);
+            break;
+        }
+        case Command::kind::rewind: {
+            set_rewinding(c.value != 0);
+            break;
+        }
+        case Command::kind::save_state: {
+            state_failed = !save_state(c.path);
+            break;
+        }
+        case Command::kind::load_state: {
+            state_failed = !load_state(c.path);
+            break;
+        }
+        }
+    }
+
+    void EmuWrapper::set_speed(double multiplier) noexcept {
+        speed      = std::max(multiplier, 0.0);
+        cycle_debt = 0.0;
+    }
+
+    double EmuWrapper::get_speed() const noexcept { return speed; }
+
+    void EmuWrapper::seed(uint64_t value) noexcept {
+        proc.seed(value);
+        // replaying from before this would draw different numbers
+        restart_timeline();
+    }
+
+    void EmuWrapper::set_display_sync(bool on) noexcept {
+        display_sync = on;
+        frames_owed  = 0;
+        pacer.reset();
+    }
+
+    bool EmuWrapper::get_display_sync() const noexcept { return display_sync; }
+
+    void EmuWrapper::vsync(double refresh_hz) noexcept {
+        if (refresh_hz <= 0.0) {
+            return;
+        }
+
+        // a 59.94Hz display runs the game 0.1% slow rather than doubling up a frame every
+        // 17 seconds
+        auto ratio   = refresh_hz / 60.0;
+        auto nearest = std::round(ratio);
+        if (nearest >= 1.0 && std::abs(ratio - nearest) < nearest * 0.01) {
+            ratio = nearest;
+        }
+
+        vsync_phase += 1.0 / ratio;
+
+        auto frames = static_cast<uint32_t>(vsync_phase + 1e-9);
+        vsync_phase = std::max(vsync_phase - frames, 0.0);
+
+        if (frames > 0) {
+            frames_owed.fetch_add(frames);
+            interrupt();
+        }
+    }
+
+    void EmuWrapper::set_cycles_per_frame(size_t cycles) noexcept {
+        proc.cycles_per_tick = std::max<size_t>(cycles, 1);
+        frame_cycles         = proc.cycles_per_tick;
+        cycle_debt           = 0.0;
+    }
+
+    size_t EmuWrapper::get_cycles_per_frame() const noexcept { return frame_cycles; }
+
+    void EmuWrapper::set_run_ahead(size_t frames) noexcept {
+        ahead_frames = frames;
+        if (frames == 0) {
+            drop_run_ahead();
+        }
+    }
+
+    size_t EmuWrapper::get_run_ahead() const noexcept { return ahead_frames; }
+
+    bool EmuWrapper::run_ahead() noexcept {
+        if (ahead_frames == 0 || !proc.save_state(ahead_state)) {
+            drop_run_ahead();
+            return false;
+        }
+
+        // whatever the sound timer does out there never happened
+        auto events = proc.sound_event_count;
+
+        auto cycles = static_cast<size_t>(static_cast<double>(proc.cycles_per_tick) * speed);
+        for (size_t i = 0; i < ahead_frames; ++i) {
+            proc.run_for(cycles);
+        }
+
+        if (!ahead_shown || proc.framebuffer != ahead_framebuffer) {
+            ahead_framebuffer = proc.framebuffer;
+            ahead_generation  = std::max(ahead_generation, proc.framebuffer_generation) + 1;
+        }
+        ahead_shown = true;
+
+        proc.load_state(ahead_state);
+        proc.sound_event_count = events;
+
+        return true;
+    }
+
+    bool EmuWrapper::save_state(MachineState& out) const noexcept { return proc.save_state(out); }
+
+    bool EmuWrapper::save_state(const std::string& path) {
+        if (!is_ready()) {
+            return false;
+        }
+
+        SaveState save;
+        if (!proc.save_state(save.state)) {
+            return false;
+        }
+        save.header.entry_point  = proc.entry_point;
+        save.header.base_address = proc.base_address;
+        seal(save);
+
+        return write_save_state(path, save);
+    }
+
+    bool EmuWrapper::load_state(const std::string& path) {
+        SaveState save;
+        if (!read_save_state(path, save)) {
+            return false;
+        }
+
+        restore(save.state, false);
+        proc.entry_point  = save.header.entry_point;
+        proc.base_address = save.header.base_address;
+        proc.is_ready     = true;
+
+        // the history leads somewhere else now
+        history.clear();
+        restart_timeline();
+
+        // carry on from the loaded state as if it were the start of a frame
+        pacer.reset();
+        frames_owed = 0;
+
+        if (is_paused()) {
+            get_next_instruction();
+        }
+
+        return true;
+    }
+
+    void EmuWrapper::restore(const MachineState& state, bool keep_keys) noexcept {
+        drop_run_ahead();
 
-    void EmuWrapper::remove_breakpoint(uint16_t addr) noexcept { breakpoints[addr] = false; }
+        bool was_sounding = proc.sound_timer > 0;
+        auto keys         = proc.keys;
+
+        proc.load_state(state);
+
+        if (keep_keys) {
+            proc.keys = keys;
+        }
+        if (was_sounding != (proc.sound_timer > 0)) {
+            proc.sound_changed(proc.cycle_count, proc.sound_timer > 0);
+        }
+
+        frame_cycles = proc.cycles_per_tick;
+        cycle_debt   = 0.0;
+    }
+
+    void EmuWrapper::set_rewind_length(size_t seconds) {
+        // a frame's delta is a few hundred bytes, so this is several times what's needed
+        constexpr size_t bytes_per_second = 64 * 1024;
+
+        history.configure(seconds * 60, seconds * bytes_per_second);
+        rewinding = rewinding && history.enabled();
+    }
+
+    void EmuWrapper::set_rewinding(bool on) noexcept { rewinding = on && history.enabled(); }
+
+    void EmuWrapper::drop_run_ahead() noexcept {
+        if (ahead_shown) {
+            ahead_shown = false;
+            // so the GUI sees a new screen, even if the real one hasn't changed
+            proc.framebuffer_generation =
+                    std::max(proc.framebuffer_generation, ahead_generation) + 1;
+        }
+    }
+
+    void EmuWrapper::set_breakpoint(uint16_t addr) noexcept {
+        breakpoint_count += !breakpoints[addr];
+        breakpoints[addr] = true;
+        proc.breakpoint_changed(addr);
+    }
+
+    void EmuWrapper::remove_breakpoint(uint16_t addr) noexcept {
+        breakpoint_count -= breakpoints[addr];
+        breakpoints[addr] = false;
+        proc.breakpoint_changed(addr);
+    }
 
     bool EmuWrapper::is_breakpoint_set(uint16_t addr) const noexcept { return breakpoints[addr]; }
 
     uint16_t EmuWrapper::get_entry() const noexcept { return proc.entry_point; }
 
+    size_t EmuWrapper::get_cycle_count() const noexcept { return proc.cycle_count; }
+    size_t EmuWrapper::get_waited_cycles() const noexcept { return proc.waited_cycles; }
+
     bool EmuWrapper::being_debugged() const noexcept { return debugging; }
     bool EmuWrapper::is_ready() const noexcept { return proc.is_ready; }
     bool EmuWrapper::is_paused() const noexcept { return emu_paused; }
-    // only read values from this class if we are both paused and not being run by debugger
+    // only read values straight from this class while paused and not being run by debugger,
+    // otherwise go through snapshot()
     bool EmuWrapper::is_readable() const noexcept { return is_paused() && !being_debugged(); }
 
     uint16_t EmuWrapper::fetch(uint16_t addr) noexcept { return proc.fetch(addr); }
-    op       EmuWrapper::decode(uint16_t opc) noexcept { return proc.decode(opc); }
+    op       EmuWrapper::decode(uint16_t opc) noexcept { return ::decode(opc); }
 
     Stack<uint16_t>& EmuWrapper::get_stack() noexcept { return proc.stack; }
 
@@ -219,11 +926,17 @@ namespace core {
     uint16_t& EmuWrapper::get_PC() noexcept { return proc.PC; }
     void      EmuWrapper::set_PC(uint8_t val) noexcept { proc.PC = val; }
 
-    std::array<uint8_t, MAX_MEMORY>& EmuWrapper::get_memory() noexcept { return proc.memory; }
+    const std::array<uint8_t, MAX_MEMORY>& EmuWrapper::get_memory() const noexcept {
+        return proc.memory;
+    }
+
+    void EmuWrapper::write_memory(uint16_t addr, uint8_t val) noexcept {
+        proc.write_memory(addr, val);
+    }
 
     std::array<bool, 16>& EmuWrapper::get_keys() noexcept { return proc.keys; }
 
-    void EmuWrapper::reset_timer() noexcept { proc.timer.reset(); }
+    void EmuWrapper::reset_timer() noexcept { pacer.reset(); }
 
     uint16_t EmuWrapper::get_opcode() const noexcept { return next_opcode; }
 } // namespace core
\ No newline at end of file
@@ -0,0 +1,1036 @@
+#include "core/jit.hpp"
+#include "core/backend.hpp"
+
+#if CHIP8_HAS_JIT
+
+#include "core/chip8.hpp"
+#include "core/basicblock.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#ifdef _WIN32
+// keep windows.h from defining min and max over std::min and std::max
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+    constexpr size_t cache_bytes = 1 << 20;
+
+    // longest block we compile, and the most code one can take, with lots of headroom.
+    // the cache is emptied whenever less than that is left
+    constexpr size_t max_block_length = 64;
+    constexpr size_t max_block_bytes  = 16384;
+
+    constexpr size_t max_pending = 256;
+
+    // a block thrown away by a write this many cycles after being compiled didn't pay for
+    // itself, and after this many of those in a row its code is left to the interpreter
+    constexpr size_t  min_lifetime = 1024;
+    constexpr uint8_t max_rewrites = 8;
+
+    // extra stack reserved by the entry stub, keeps rsp 16 byte aligned for helper calls
+    // and doubles as shadow space on windows
+    constexpr int32_t frame_bytes = 40;
+
+    enum reg : uint8_t
+    {
+        rax,
+        rcx,
+        rdx,
+        rbx,
+        rsp,
+        rbp,
+        rsi,
+        rdi,
+        r8,
+        r9,
+        r10,
+        r11,
+        r12,
+        r13,
+        r14,
+        r15
+    };
+
+    // register assignment inside the code cache, all callee saved
+    constexpr reg ctx_reg       = rbx; // JitContext*
+    constexpr reg v_reg         = r12; // &V[0]
+    constexpr reg self_reg      = r13; // Chip8*
+    constexpr reg budget_reg    = r14; // cycles left
+    constexpr reg countdown_reg = r15; // cycles until the next timer tick
+
+#ifdef _WIN32
+    constexpr reg arg0 = rcx;
+    constexpr reg arg1 = rdx;
+#else
+    constexpr reg arg0 = rdi;
+    constexpr reg arg1 = rsi;
+#endif
+
+    // low nibble of jcc/setcc opcodes
+    enum cond : uint8_t
+    {
+        cc_e  = 0x4,
+        cc_ne = 0x5,
+        cc_ae = 0x3,
+        cc_a  = 0x7,
+        cc_ge = 0xD
+    };
+
+    // /digit of the 0x80/0x81 immediate group
+    enum alu : uint8_t
+    {
+        alu_add = 0,
+        alu_or  = 1,
+        alu_and = 4,
+        alu_sub = 5,
+        alu_cmp = 7
+    };
+
+    // just enough of an x86-64 assembler for the code below. every memory operand
+    // is [base + disp32]
+    class Emitter {
+        uint8_t* cur;
+        uint8_t* end;
+
+    public:
+        bool overflow = false;
+
+        Emitter(uint8_t* begin, uint8_t* finish) : cur{ begin }, end{ finish } {}
+
+        uint8_t* pos() const noexcept { return cur; }
+
+        void u8(uint8_t v) noexcept {
+            if (cur < end) {
+                *cur++ = v;
+            }
+            else {
+                overflow = true;
+            }
+        }
+        void u16(uint16_t v) noexcept {
+            u8(v & 0xFF);
+            u8(v >> 8);
+        }
+        void u32(uint32_t v) noexcept {
+            for (auto i = 0; i < 4; ++i) {
+                u8((v >> (8 * i)) & 0xFF);
+            }
+        }
+        void u64(uint64_t v) noexcept {
+            for (auto i = 0; i < 8; ++i) {
+                u8((v >> (8 * i)) & 0xFF);
+            }
+        }
+
+        void rex(bool w, uint8_t r, uint8_t b) noexcept {
+            uint8_t v = 0x40 | (w << 3) | ((r >> 3) << 2) | (b >> 3);
+            if (v != 0x40) {
+                u8(v);
+            }
+        }
+        void mem(uint8_t r, uint8_t base, int32_t disp) noexcept {
+            u8(0x80 | ((r & 7) << 3) | (base & 7));
+            // rsp/r12 as a base needs a SIB byte
+            if ((base & 7) == rsp) {
+                u8(0x24);
+            }
+            u32(static_cast<uint32_t>(disp));
+        }
+        void direct(uint8_t r, uint8_t rm) noexcept { u8(0xC0 | ((r & 7) << 3) | (rm & 7)); }
+
+        // 8 bit, only ever with al/cl/dl so no REX is forced
+        void mov_r8_m(reg r, reg base, int32_t disp) noexcept {
+            rex(false, r, base);
+            u8(0x8A);
+            mem(r, base, disp);
+        }
+        void mov_m_r8(reg base, int32_t disp, reg r) noexcept {
+            rex(false, r, base);
+            u8(0x88);
+            mem(r, base, disp);
+        }
+        void mov_m_imm8(reg base, int32_t disp, uint8_t imm) noexcept {
+            rex(false, 0, base);
+            u8(0xC6);
+            mem(0, base, disp);
+            u8(imm);
+        }
+        void alu_m_imm8(alu op, reg base, int32_t disp, uint8_t imm) noexcept {
+            rex(false, 0, base);
+            u8(0x80);
+            mem(op, base, disp);
+            u8(imm);
+        }
+        // op [base + disp], r8. opcode is 0x00 add, 0x08 or, 0x20 and, 0x30 xor
+        void alu_m_r8(uint8_t opcode, reg base, int32_t disp, reg r) noexcept {
+            rex(false, r, base);
+            u8(opcode);
+            mem(r, base, disp);
+        }
+        // op r8, [base + disp]. opcode is 0x02 add, 0x2A sub, 0x3A cmp
+        void alu_r8_m(uint8_t opcode, reg r, reg base, int32_t disp) noexcept {
+            rex(false, r, base);
+            u8(opcode);
+            mem(r, base, disp);
+        }
+        // shl (4) or shr (5) byte [base + disp], 1
+        void shift_m8(uint8_t digit, reg base, int32_t disp) noexcept {
+            rex(false, 0, base);
+            u8(0xD0);
+            mem(digit, base, disp);
+        }
+        void shr_r8(reg r, uint8_t imm) noexcept {
+            u8(0xC0);
+            direct(5, r);
+            u8(imm);
+        }
+        void and_r8(reg r, uint8_t imm) noexcept {
+            u8(0x80);
+            direct(4, r);
+            u8(imm);
+        }
+        void cmp_r8_r8(reg a, reg b) noexcept {
+            u8(0x38);
+            direct(b, a);
+        }
+        void setcc(cond c, reg r) noexcept {
+            u8(0x0F);
+            u8(0x90 | c);
+            direct(0, r);
+        }
+
+        // 16/32 bit
+        void movzx_r32_m8(reg r, reg base, int32_t disp) noexcept {
+            rex(false, r, base);
+            u8(0x0F);
+            u8(0xB6);
+            mem(r, base, disp);
+        }
+        void movzx_r32_m16(reg r, reg base, int32_t disp) noexcept {
+            rex(false, r, base);
+            u8(0x0F);
+            u8(0xB7);
+            mem(r, base, disp);
+        }
+        void mov_m16_imm(reg base, int32_t disp, uint16_t imm) noexcept {
+            u8(0x66);
+            rex(false, 0, base);
+            u8(0xC7);
+            mem(0, base, disp);
+            u16(imm);
+        }
+        void mov_m16_r16(reg base, int32_t disp, reg r) noexcept {
+            u8(0x66);
+            rex(false, r, base);
+            u8(0x89);
+            mem(r, base, disp);
+        }
+        void add_m16_r16(reg base, int32_t disp, reg r) noexcept {
+            u8(0x66);
+            rex(false, r, base);
+            u8(0x01);
+            mem(r, base, disp);
+        }
+        void mov_r32_r32(reg dst, reg src) noexcept {
+            rex(false, src, dst);
+            u8(0x89);
+            direct(src, dst);
+        }
+        void alu_r32_imm(alu op, reg r, uint32_t imm) noexcept {
+            rex(false, 0, r);
+            u8(0x81);
+            direct(op, r);
+            u32(imm);
+        }
+        void cmp_r32_r32(reg a, reg b) noexcept {
+            rex(false, b, a);
+            u8(0x39);
+            direct(b, a);
+        }
+        void xor_eax() noexcept {
+            u8(0x31);
+            u8(0xC0);
+        }
+        // lea eax, [rax + rax * 4]
+        void times5_eax() noexcept {
+            u8(0x8D);
+            u8(0x04);
+            u8(0x80);
+        }
+        // cmp byte [rcx + rax], 0
+        void cmp_rcx_rax_zero() noexcept {
+            u8(0x80);
+            u8(0x3C);
+            u8(0x01);
+            u8(0x00);
+        }
+        // mov rax, [rcx + rax * 4]
+        void load_entry_rcx_rax() noexcept {
+            u8(0x48);
+            u8(0x8B);
+            u8(0x04);
+            u8(0x81);
+        }
+
+        // 64 bit
+        void mov_r64_m(reg r, reg base, int32_t disp) noexcept {
+            rex(true, r, base);
+            u8(0x8B);
+            mem(r, base, disp);
+        }
+        void mov_m_r64(reg base, int32_t disp, reg r) noexcept {
+            rex(true, r, base);
+            u8(0x89);
+            mem(r, base, disp);
+        }
+        void mov_r64_r64(reg dst, reg src) noexcept {
+            rex(true, src, dst);
+            u8(0x89);
+            direct(src, dst);
+        }
+        void mov_r64_imm(reg r, uint64_t imm) noexcept {
+            rex(true, 0, r);
+            u8(0xB8 | (r & 7));
+            u64(imm);
+        }
+        void alu_r64_imm(alu op, reg r, int32_t imm) noexcept {
+            rex(true, 0, r);
+            u8(0x81);
+            direct(op, r);
+            u32(static_cast<uint32_t>(imm));
+        }
+        void test_r64(reg r) noexcept {
+            rex(true, r, r);
+            u8(0x85);
+            direct(r, r);
+        }
+        void push(reg r) noexcept {
+            rex(false, 0, r);
+            u8(0x50 | (r & 7));
+        }
+        void pop(reg r) noexcept {
+            rex(false, 0, r);
+            u8(0x58 | (r & 7));
+        }
+        void call_r64(reg r) noexcept {
+            rex(false, 0, r);
+            u8(0xFF);
+            direct(2, r);
+        }
+        void jmp_r64(reg r) noexcept {
+            rex(false, 0, r);
+            u8(0xFF);
+            direct(4, r);
+        }
+        void ret() noexcept { u8(0xC3); }
+
+        // lea r, [rip + (target - next instruction)]
+        void lea_rip(reg r, const uint8_t* target) noexcept {
+            rex(true, r, 0);
+            u8(0x8D);
+            u8(0x05 | ((r & 7) << 3));
+            u32(static_cast<uint32_t>(target - (cur + 4)));
+        }
+
+        // jumps to a known address
+        void jmp(const uint8_t* target) noexcept {
+            u8(0xE9);
+            u32(static_cast<uint32_t>(target - (cur + 4)));
+        }
+        // forward jumps, returns the rel32 to fix up with bind()
+        uint8_t* jmp_forward() noexcept {
+            u8(0xE9);
+            auto patch = cur;
+            u32(0);
+            return patch;
+        }
+        uint8_t* jcc_forward(cond c) noexcept {
+            u8(0x0F);
+            u8(0x80 | c);
+            auto patch = cur;
+            u32(0);
+            return patch;
+        }
+        void bind(uint8_t* patch) noexcept {
+            if (!overflow) {
+                int32_t rel = static_cast<int32_t>(cur - (patch + 4));
+                std::memcpy(patch, &rel, sizeof(rel));
+            }
+        }
+    };
+
+    // control leaves the block after these
+    bool ends_jit_block(op o) {
+        return is_jump_or_ret(o) || o == op::CALL || o == op::SYS || o == op::LD_K;
+    }
+
+    // never compiled, the block stops right before them
+    bool needs_interpreter(op o) { return o == op::JP_V0 || o == op::LD_K || o == op::UNKNOWN; }
+
+    void write_rel32(uint8_t* site, const uint8_t* target) {
+        // site is a jmp rel32, E9 xx xx xx xx
+        int32_t rel = static_cast<int32_t>(target - (site + 5));
+        std::memcpy(site + 1, &rel, sizeof(rel));
+    }
+} // namespace
+
+namespace core {
+
+    Jit::Jit(Chip8& c) : chip{ c } {
+        ctx.V            = chip.V.data();
+        ctx.PC           = &chip.PC;
+        ctx.I            = &chip.I;
+        ctx.delay_timer  = &chip.delay_timer;
+        ctx.keys         = chip.keys.data();
+        ctx.self         = &chip;
+        ctx.entry_points = entry_points.data();
+
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        page_size = info.dwPageSize;
+
+        void* mem = VirtualAlloc(nullptr, cache_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+        if (auto size = sysconf(_SC_PAGESIZE); size > 0) {
+            page_size = static_cast<size_t>(size);
+        }
+
+        void* mem = mmap(nullptr, cache_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                         -1, 0);
+        if (mem == MAP_FAILED) {
+            mem = nullptr;
+        }
+#endif
+        if (mem == nullptr) {
+            return;
+        }
+
+        cache          = static_cast<uint8_t*>(mem);
+        cache_size     = cache_bytes;
+        writable_begin = cache;
+        writable_end   = cache + cache_size;
+
+        emit_stubs();
+    }
+
+    Jit::~Jit() {
+        if (cache != nullptr) {
+#ifdef _WIN32
+            VirtualFree(cache, 0, MEM_RELEASE);
+#else
+            munmap(cache, cache_size);
+#endif
+        }
+    }
+
+    bool Jit::usable() const noexcept { return cache != nullptr && enter != nullptr; }
+
+    bool Jit::make_writable(uint8_t* at, size_t len) noexcept {
+        // only the pages written, the rest of the cache stays executable
+        auto offset = static_cast<size_t>(at - cache);
+        auto begin  = cache + offset / page_size * page_size;
+        auto end    = cache + (offset + len + page_size - 1) / page_size * page_size;
+        end         = std::min(end, cache + cache_size);
+
+        if (writable_begin != writable_end) {
+            if (begin >= writable_begin && end <= writable_end) {
+                return true;
+            }
+            // a single window, so going back to code is always one call
+            begin = std::min(begin, writable_begin);
+            end   = std::max(end, writable_end);
+        }
+#ifdef _WIN32
+        DWORD old;
+        bool  ok = VirtualProtect(begin, end - begin, PAGE_READWRITE, &old) != 0;
+#else
+        bool ok = mprotect(begin, end - begin, PROT_READ | PROT_WRITE) == 0;
+#endif
+        if (ok) {
+            writable_begin = begin;
+            writable_end   = end;
+        }
+        return ok;
+    }
+
+    bool Jit::make_executable() noexcept {
+        if (writable_begin == writable_end) {
+            return true;
+        }
+        auto len = static_cast<size_t>(writable_end - writable_begin);
+#ifdef _WIN32
+        DWORD old;
+        bool  ok = VirtualProtect(writable_begin, len, PAGE_EXECUTE_READ, &old) != 0;
+        FlushInstructionCache(GetCurrentProcess(), writable_begin, len);
+#else
+        bool ok = mprotect(writable_begin, len, PROT_READ | PROT_EXEC) == 0;
+#endif
+        if (ok) {
+            writable_begin = nullptr;
+            writable_end   = nullptr;
+        }
+        return ok;
+    }
+
+    // entry and exit stubs shared by every block
+    void Jit::emit_stubs() noexcept {
+        Emitter e(cache, cache + cache_size);
+
+        // uintptr_t enter(JitContext* ctx, const void* code)
+        auto entry = e.pos();
+        e.push(rbx);
+        e.push(rbp);
+        e.push(r12);
+        e.push(r13);
+        e.push(r14);
+        e.push(r15);
+        e.alu_r64_imm(alu_sub, rsp, frame_bytes);
+        e.mov_r64_r64(ctx_reg, arg0);
+        e.mov_r64_m(v_reg, ctx_reg, offsetof(JitContext, V));
+        e.mov_r64_m(self_reg, ctx_reg, offsetof(JitContext, self));
+        e.mov_r64_m(budget_reg, ctx_reg, offsetof(JitContext, budget));
+        e.mov_r64_m(countdown_reg, ctx_reg, offsetof(JitContext, countdown));
+        e.jmp_r64(arg1);
+
+        // blocks jump here to leave, with the return value in rax
+        exit_stub = e.pos();
+        e.mov_m_r64(ctx_reg, offsetof(JitContext, budget), budget_reg);
+        e.mov_m_r64(ctx_reg, offsetof(JitContext, countdown), countdown_reg);
+        e.alu_r64_imm(alu_add, rsp, frame_bytes);
+        e.pop(r15);
+        e.pop(r14);
+        e.pop(r13);
+        e.pop(r12);
+        e.pop(rbp);
+        e.pop(rbx);
+        e.ret();
+
+        if (e.overflow) {
+            return;
+        }
+
+        enter      = reinterpret_cast<entry_fn>(entry);
+        code_start = e.pos();
+        cache_free = code_start;
+    }
+
+    void Jit::exec_helper(Chip8* self, const void* ins) noexcept {
+        self->execute(*static_cast<const Decoded*>(ins));
+    }
+
+    int64_t Jit::tick_helper(Chip8* self, int64_t countdown) noexcept {
+        // timer_event is only brought up to date after a run, but update_timers stamps
+        // sound events with it
+        auto period = static_cast<int64_t>(self->cycles_per_tick);
+        while (countdown < 0) {
+            self->update_timers();
+            self->timer_event += self->cycles_per_tick;
+            countdown += period;
+        }
+        return countdown;
+    }
+
+    Jit::block* Jit::compile(uint16_t addr) noexcept {
+        auto bb = scan_block(chip.memory, addr, max_block_length, ends_jit_block);
+
+        if (!bb.instructions.empty() && needs_interpreter(bb.instructions.back().operation)) {
+            bb.instructions.pop_back();
+        }
+        if (bb.instructions.empty()) {
+            uncompilable[addr >> 1] = true;
+            return nullptr;
+        }
+
+        if (cache_free + max_block_bytes > cache + cache_size) {
+            drop_blocks();
+        }
+        if (!make_writable(cache_free, max_block_bytes)) {
+            return nullptr;
+        }
+
+        const auto len = static_cast<int32_t>(bb.instructions.size());
+
+        Emitter e(cache_free, cache_free + max_block_bytes);
+
+        auto code = e.pos();
+
+        auto store_pc = [&](uint16_t value) {
+            e.mov_r64_m(rcx, ctx_reg, offsetof(JitContext, PC));
+            e.mov_m16_imm(rcx, 0, value);
+        };
+
+        // run the interpreter's version of an instruction
+        auto call_helper = [&](const Decoded& d) {
+            e.mov_r64_r64(arg0, self_reg);
+            e.mov_r64_imm(arg1, reinterpret_cast<uintptr_t>(&d));
+            e.mov_r64_imm(rax, reinterpret_cast<uintptr_t>(&Jit::exec_helper));
+            e.call_r64(rax);
+        };
+
+        // account for the timer ticks of the last `count` instructions. nothing between
+        // two syncs reads or writes the timers, so ticking late is unobservable
+        auto sync = [&](int32_t count) {
+            if (count == 0) {
+                return;
+            }
+            e.alu_r64_imm(alu_sub, countdown_reg, count);
+            auto done = e.jcc_forward(cc_ge);
+            e.mov_r64_r64(arg0, self_reg);
+            e.mov_r64_r64(arg1, countdown_reg);
+            e.mov_r64_imm(rax, reinterpret_cast<uintptr_t>(&Jit::tick_helper));
+            e.call_r64(rax);
+            e.mov_r64_r64(countdown_reg, rax);
+            e.bind(done);
+        };
+
+        // leave the block for `target`. the leading jmp falls through until the exit is
+        // linked, then it goes straight to the target block instead
+        auto linkable_exit = [&](uint16_t target) {
+            auto site = e.pos();
+            e.u8(0xE9);
+            e.u32(0);
+            store_pc(target);
+            e.lea_rip(rax, site);
+            e.jmp(exit_stub);
+        };
+
+        // leave after `executed` instructions rather than the whole block
+        auto early_exit = [&](uint16_t target, int32_t executed) {
+            if (executed < len) {
+                e.alu_r64_imm(alu_add, budget_reg, len - executed);
+            }
+            store_pc(target);
+            e.xor_eax();
+            e.jmp(exit_stub);
+        };
+
+        // only enter if the whole block fits in what's left of the budget
+        e.alu_r64_imm(alu_sub, budget_reg, len);
+        auto fits = e.jcc_forward(cc_ge);
+        early_exit(addr, 0);
+        e.bind(fits);
+
+        int32_t since_sync = 0;
+        bool    terminated = false;
+
+        for (int32_t i = 0; i < len; ++i) {
+            const uint16_t a = bb.instructions[i].address;
+            const auto&    d = chip.decoded[a >> 1];
+
+            const int32_t x  = d.x;
+            const int32_t y  = d.y;
+            const int32_t vf = 0xF;
+
+            since_sync++;
+
+            switch (d.operation) {
+            case op::LD_I: {
+                e.mov_m_imm8(v_reg, x, d.nn);
+                break;
+            }
+            case op::ADD_I: {
+                e.alu_m_imm8(alu_add, v_reg, x, d.nn);
+                break;
+            }
+            case op::LD_R: {
+                e.mov_r8_m(rax, v_reg, y);
+                e.mov_m_r8(v_reg, x, rax);
+                break;
+            }
+            case op::OR: {
+                e.mov_r8_m(rax, v_reg, y);
+                e.alu_m_r8(0x08, v_reg, x, rax);
+                break;
+            }
+            case op::AND: {
+                e.mov_r8_m(rax, v_reg, y);
+                e.alu_m_r8(0x20, v_reg, x, rax);
+                break;
+            }
+            case op::XOR: {
+                e.mov_r8_m(rax, v_reg, y);
+                e.alu_m_r8(0x30, v_reg, x, rax);
+                break;
+            }
+            case op::ADD_R: {
+                // VF = !(original < result), written after Vx like the interpreter
+                e.mov_r8_m(rax, v_reg, x);
+                e.mov_r8_m(rcx, v_reg, x);
+                e.alu_r8_m(0x02, rax, v_reg, y);
+                e.mov_m_r8(v_reg, x, rax);
+                e.cmp_r8_r8(rcx, rax);
+                e.setcc(cc_ae, rdx);
+                e.mov_m_r8(v_reg, vf, rdx);
+                break;
+            }
+            case op::SUB: {
+                // VF is written first, then Vx/Vy are read again in case either is VF
+                e.mov_r8_m(rax, v_reg, x);
+                e.alu_r8_m(0x3A, rax, v_reg, y);
+                e.setcc(cc_a, rcx);
+                e.mov_m_r8(v_reg, vf, rcx);
+                e.mov_r8_m(rax, v_reg, x);
+                e.alu_r8_m(0x2A, rax, v_reg, y);
+                e.mov_m_r8(v_reg, x, rax);
+                break;
+            }
+            case op::SUBN: {
+                e.mov_r8_m(rax, v_reg, y);
+                e.alu_r8_m(0x3A, rax, v_reg, x);
+                e.setcc(cc_a, rcx);
+                e.mov_m_r8(v_reg, vf, rcx);
+                e.mov_r8_m(rax, v_reg, y);
+                e.alu_r8_m(0x2A, rax, v_reg, x);
+                e.mov_m_r8(v_reg, x, rax);
+                break;
+            }
+            case op::SHR: {
+                e.mov_r8_m(rax, v_reg, x);
+                e.and_r8(rax, 1);
+                e.mov_m_r8(v_reg, vf, rax);
+                e.shift_m8(5, v_reg, x);
+                break;
+            }
+            case op::SHL: {
+                e.mov_r8_m(rax, v_reg, x);
+                e.shr_r8(rax, 7);
+                e.mov_m_r8(v_reg, vf, rax);
+                e.shift_m8(4, v_reg, x);
+                break;
+            }
+            case op::LD_I2: {
+                e.mov_r64_m(rcx, ctx_reg, offsetof(JitContext, I));
+                e.mov_m16_imm(rcx, 0, d.nnn);
+                break;
+            }
+            case op::ADD_I2: {
+                e.movzx_r32_m8(rax, v_reg, x);
+                e.mov_r64_m(rcx, ctx_reg, offsetof(JitContext, I));
+                e.add_m16_r16(rcx, 0, rax);
+                break;
+            }
+            case op::LD_F: {
+                e.movzx_r32_m8(rax, v_reg, x);
+                e.times5_eax();
+                e.mov_r64_m(rcx, ctx_reg, offsetof(JitContext, I));
+                e.mov_m16_r16(rcx, 0, rax);
+                break;
+            }
+            case op::LD_DT: {
+                sync(since_sync);
+                since_sync = 0;
+                e.mov_r64_m(rcx, ctx_reg, offsetof(JitContext, delay_timer));
+                e.mov_r8_m(rax, rcx, 0);
+                e.mov_m_r8(v_reg, x, rax);
+                break;
+            }
+            case op::LD_DT2: {
+                sync(since_sync);
+                since_sync = 0;
+                e.mov_r8_m(rax, v_reg, x);
+                e.mov_r64_m(rcx, ctx_reg, offsetof(JitContext, delay_timer));
+                e.mov_m_r8(rcx, 0, rax);
+                break;
+            }
+            case op::LD_ST: {
+                sync(since_sync);
+                since_sync = 0;
+                call_helper(d);
+                break;
+            }
+            case op::CLS:
+            case op::RND:
+            case op::DRW:
+            case op::LOAD: {
+                call_helper(d);
+                break;
+            }
+            case op::LD_B:
+            case op::DUMP: {
+                call_helper(d);
+
+                // if that wrote over compiled code, this block may be stale from here on
+                e.alu_m_imm8(alu_cmp, ctx_reg, offsetof(JitContext, code_dirty), 0);
+                auto clean = e.jcc_forward(cc_e);
+                sync(since_sync);
+                early_exit(a + 2, i + 1);
+                e.bind(clean);
+                break;
+            }
+            case op::JP: {
+                sync(since_sync);
+                linkable_exit(d.nnn);
+                terminated = true;
+                break;
+            }
+            case op::CALL:
+            case op::SYS: {
+                // the return address pushed is this instruction's, as in the interpreter
+                store_pc(a);
+                call_helper(d);
+                sync(since_sync);
+                linkable_exit(d.nnn);
+                terminated = true;
+                break;
+            }
+            case op::RET: {
+                call_helper(d);
+                sync(since_sync);
+
+                // PC is now the CALL we came from, step past it
+                e.mov_r64_m(rcx, ctx_reg, offsetof(JitContext, PC));
+                e.movzx_r32_m16(rax, rcx, 0);
+                e.alu_r32_imm(alu_add, rax, 2);
+                e.mov_m16_r16(rcx, 0, rax);
+
+                // jump straight to the block there, if it is compiled and PC is sane
+                e.mov_r32_r32(rdx, rax);
+                e.alu_r32_imm(alu_and, rdx, MAX_MEMORY - 2);
+                e.cmp_r32_r32(rdx, rax);
+                auto bad_pc = e.jcc_forward(cc_ne);
+                e.mov_r64_m(rcx, ctx_reg, offsetof(JitContext, entry_points));
+                e.load_entry_rcx_rax();
+                e.test_r64(rax);
+                auto not_compiled = e.jcc_forward(cc_e);
+                e.jmp_r64(rax);
+                e.bind(bad_pc);
+                e.bind(not_compiled);
+                e.xor_eax();
+                e.jmp(exit_stub);
+                terminated = true;
+                break;
+            }
+            case op::SE_I:
+            case op::SNE_I:
+            case op::SE_R:
+            case op::SNE_R:
+            case op::SKP:
+            case op::SKNP: {
+                sync(since_sync);
+
+                cond skip = cc_e;
+
+                if (d.operation == op::SE_I || d.operation == op::SNE_I) {
+                    e.alu_m_imm8(alu_cmp, v_reg, x, d.nn);
+                    skip = d.operation == op::SE_I ? cc_e : cc_ne;
+                }
+                else if (d.operation == op::SE_R || d.operation == op::SNE_R) {
+                    e.mov_r8_m(rax, v_reg, x);
+                    e.alu_r8_m(0x3A, rax, v_reg, y);
+                    skip = d.operation == op::SE_R ? cc_e : cc_ne;
+                }
+                else {
+                    e.movzx_r32_m8(rax, v_reg, x);
+                    e.alu_r32_imm(alu_and, rax, 0xF);
+                    e.mov_r64_m(rcx, ctx_reg, offsetof(JitContext, keys));
+                    e.cmp_rcx_rax_zero();
+                    skip = d.operation == op::SKP ? cc_ne : cc_e;
+                }
+
+                auto taken = e.jcc_forward(skip);
+                linkable_exit(a + 2);
+                e.bind(taken);
+                linkable_exit(a + 4);
+                terminated = true;
+                break;
+            }
+            default: {
+                // needs_interpreter() ops never get here
+                break;
+            }
+            }
+        }
+
+        // ran off the end of the block without a jump, continue after it
+        if (!terminated) {
+            sync(since_sync);
+            linkable_exit(bb.instructions.back().address + 2);
+        }
+
+        if (e.overflow) {
+            drop_blocks();
+            return nullptr;
+        }
+
+        cache_free = e.pos();
+
+        auto b         = std::make_unique<block>();
+        b->start       = addr;
+        b->end         = bb.instructions.back().address + 2;
+        b->code        = code;
+        b->compiled_at = chip.cycle_count;
+        b->live        = true;
+
+        for (auto i = b->start; i < b->end; ++i) {
+            coverage[i]++;
+        }
+
+        by_address[addr >> 1]   = b.get();
+        entry_points[addr >> 1] = code;
+
+        blocks.push_back(std::move(b));
+        return blocks.back().get();
+    }
+
+    Jit::block* Jit::lookup_or_compile(uint16_t addr) noexcept {
+        if ((addr & 1) || addr > MAX_MEMORY - 2 || uncompilable[addr >> 1] ||
+            rewrites[addr >> 1] >= max_rewrites) {
+            return nullptr;
+        }
+        if (auto b = by_address[addr >> 1]; b != nullptr) {
+            return b;
+        }
+        return compile(addr);
+    }
+
+    void Jit::link(uint8_t* site, block* target) noexcept {
+        if (!make_writable(site, 5)) {
+            return;
+        }
+        write_rel32(site, target->code);
+        target->incoming.push_back(site);
+    }
+
+    void Jit::kill(block& b) noexcept {
+        if (by_address[b.start >> 1] == &b) {
+            by_address[b.start >> 1]   = nullptr;
+            entry_points[b.start >> 1] = nullptr;
+        }
+
+        // unlinked exits fall through into the code that goes back to the dispatcher
+        for (auto site : b.incoming) {
+            if (make_writable(site, 5)) {
+                write_rel32(site, site + 5);
+            }
+        }
+        b.incoming.clear();
+
+        for (auto i = b.start; i < b.end; ++i) {
+            coverage[i]--;
+        }
+        // the code itself stays put until the next flush, it may be what we just came from
+        b.live = false;
+    }
+
+    void Jit::apply_invalidations() noexcept {
+        if (pending_flush) {
+            drop_blocks();
+            return;
+        }
+        for (auto [addr, len] : pending) {
+            for (auto& b : blocks) {
+                if (b->live && addr < b->end && addr + len > b->start) {
+                    auto& r = rewrites[b->start >> 1];
+                    r       = chip.cycle_count - b->compiled_at >= min_lifetime
+                                  ? 0
+                                  : std::min<uint8_t>(r + 1, max_rewrites);
+                    kill(*b);
+                }
+            }
+        }
+        pending.clear();
+        ctx.code_dirty = 0;
+    }
+
+    void Jit::invalidate(uint16_t addr, uint16_t len) noexcept {
+        for (uint16_t i = 0; i < len; ++i) {
+            uncompilable[((addr + i) & (MAX_MEMORY - 1)) >> 1] = false;
+        }
+        for (uint16_t i = 0; i < len; ++i) {
+            if (coverage[(addr + i) & (MAX_MEMORY - 1)] != 0) {
+                if (pending.size() >= max_pending) {
+                    pending_flush = true;
+                    pending.clear();
+                }
+                if (!pending_flush) {
+                    pending.emplace_back(addr, len);
+                }
+                ctx.code_dirty = 1;
+                return;
+            }
+        }
+    }
+
+    void Jit::drop_blocks() noexcept {
+        blocks.clear();
+        by_address   = {};
+        entry_points = {};
+        coverage     = {};
+        uncompilable = {};
+        pending.clear();
+        pending_flush = false;
+
+        ctx.code_dirty = 0;
+        cache_free     = code_start;
+        generation++;
+    }
+
+    void Jit::flush() noexcept {
+        drop_blocks();
+        rewrites = {};
+    }
+
+    void Jit::run(size_t cycles) {
+        size_t remaining = cycles;
+
+        while (remaining > 0) {
+            if (!pending.empty() || pending_flush) {
+                apply_invalidations();
+            }
+
+            auto b = lookup_or_compile(chip.PC);
+
+            // code we can't or won't compile, interpret it until control flow goes somewhere
+            // else rather than coming back here every instruction
+            if (b == nullptr || !make_executable()) {
+                uint16_t from;
+                do {
+                    from = chip.PC;
+                    chip.step();
+                    remaining--;
+                } while (remaining > 0 && chip.PC == static_cast<uint16_t>(from + 2));
+                continue;
+            }
+
+            ctx.budget = static_cast<int64_t>(remaining);
+            ctx.countdown = static_cast<int64_t>(chip.timer_event - chip.cycle_count);
+
+            auto gen  = generation;
+            auto site = reinterpret_cast<uint8_t*>(enter(&ctx, b->code));
+
+            auto executed = remaining - static_cast<size_t>(ctx.budget);
+            chip.cycle_count += executed;
+            chip.timer_event = chip.cycle_count + static_cast<size_t>(ctx.countdown);
+            remaining -= executed;
+
+            // not even the first block fit in the budget, finish off one at a time
+            if (executed == 0) {
+                chip.step();
+                remaining--;
+                continue;
+            }
+
+            if (site != nullptr && pending.empty() && !pending_flush) {
+                auto target = lookup_or_compile(chip.PC);
+                if (target != nullptr && generation == gen) {
+                    link(site, target);
+                }
+            }
+        }
+    }
+} // namespace core
+
+#endif
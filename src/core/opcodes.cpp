@@ -15,6 +15,18 @@ bool is_jump_or_call(op opcode) {
     return false;
 }
 
+bool is_jump_or_ret(op opcode) {
+    static std::array<op, 11> jumps = { op::JP,    op::JP_V0, op::SE_I, op::SE_R, op::SNE_I,
+                                        op::SNE_R, op::SKP,   op::SKNP, op::RET,  op::UNKNOWN };
+
+    for (auto j : jumps) {
+        if (j == opcode) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool is_followable(op opcode) {
     if (opcode == op::JP_V0) {
         return false;
@@ -0,0 +1,238 @@
+#include "core/rewind.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if CHIP8_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+    void put_u16(uint8_t* out, size_t value) noexcept {
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    size_t get_u16(const uint8_t* in) noexcept {
+        return static_cast<size_t>(in[0]) | static_cast<size_t>(in[1]) << 8;
+    }
+
+#if CHIP8_HAS_SSE2
+    bool same_block(const uint8_t* a, const uint8_t* b) noexcept {
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+        auto y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) == 0xFFFF;
+    }
+
+    // out = a ^ b
+    void xor_block(const uint8_t* a, const uint8_t* b, uint8_t* out) noexcept {
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+        auto y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_xor_si128(x, y));
+    }
+#else
+    bool same_block(const uint8_t* a, const uint8_t* b) noexcept {
+        return std::memcmp(a, b, core::delta_block) == 0;
+    }
+
+    void xor_block(const uint8_t* a, const uint8_t* b, uint8_t* out) noexcept {
+        uint64_t x[2], y[2];
+        std::memcpy(x, a, sizeof(x));
+        std::memcpy(y, b, sizeof(y));
+        x[0] ^= y[0];
+        x[1] ^= y[1];
+        std::memcpy(out, x, sizeof(x));
+    }
+#endif
+} // namespace
+
+namespace core {
+
+    size_t encode_delta(const MachineState& a, const MachineState& b, uint8_t* out) noexcept {
+        auto pa = reinterpret_cast<const uint8_t*>(&a);
+        auto pb = reinterpret_cast<const uint8_t*>(&b);
+
+        size_t size = 0;
+        size_t i    = 0;
+
+        while (i < delta_blocks) {
+            auto skip_start = i;
+            while (i < delta_blocks && same_block(pa + i * delta_block, pb + i * delta_block)) {
+                ++i;
+            }
+            auto changed_start = i;
+            while (i < delta_blocks && !same_block(pa + i * delta_block, pb + i * delta_block)) {
+                ++i;
+            }
+
+            // unchanged blocks at the end need no run
+            if (i == changed_start) {
+                break;
+            }
+
+            put_u16(out + size, changed_start - skip_start);
+            put_u16(out + size + 2, i - changed_start);
+            size += 4;
+
+            for (auto j = changed_start; j < i; ++j) {
+                xor_block(pa + j * delta_block, pb + j * delta_block, out + size);
+                size += delta_block;
+            }
+        }
+
+        return size;
+    }
+
+    bool apply_delta(MachineState& state, const uint8_t* delta, size_t size) noexcept {
+        auto p = reinterpret_cast<uint8_t*>(&state);
+
+        size_t pos   = 0;
+        size_t block = 0;
+
+        while (pos < size) {
+            if (size - pos < 4) {
+                return false;
+            }
+            auto skip    = get_u16(delta + pos);
+            auto changed = get_u16(delta + pos + 2);
+            pos += 4;
+
+            block += skip;
+            if (block + changed > delta_blocks || size - pos < changed * delta_block) {
+                return false;
+            }
+
+            for (size_t j = 0; j < changed; ++j, ++block) {
+                auto target = p + block * delta_block;
+                xor_block(target, delta + pos, target);
+                pos += delta_block;
+            }
+        }
+
+        return true;
+    }
+
+    void RewindBuffer::configure(size_t frames, size_t max_bytes) {
+        clear();
+
+        if (frames == 0) {
+            bytes   = {};
+            entries = {};
+            scratch = {};
+            return;
+        }
+
+        bytes.assign(max_bytes, 0);
+        entries.assign(frames, {});
+        scratch.assign(max_delta_size, 0);
+    }
+
+    bool RewindBuffer::enabled() const noexcept { return !entries.empty(); }
+
+    void RewindBuffer::clear() noexcept {
+        first     = 0;
+        count     = 0;
+        write_pos = 0;
+        used      = 0;
+        has_head  = false;
+    }
+
+    RewindBuffer::entry& RewindBuffer::newest() noexcept {
+        return entries[(first + count - 1) % entries.size()];
+    }
+
+    void RewindBuffer::drop_oldest() noexcept {
+        used -= entries[first].size;
+        first = (first + 1) % entries.size();
+        count--;
+
+        if (count == 0) {
+            write_pos = 0;
+        }
+    }
+
+    size_t RewindBuffer::make_room(size_t size) noexcept {
+        for (;;) {
+            if (count == 0) {
+                return 0;
+            }
+
+            auto start   = entries[first].offset;
+            bool wrapped = newest().offset < start;
+
+            if (!wrapped) {
+                // free at the end, and before the oldest at the beginning
+                if (bytes.size() - write_pos >= size) {
+                    return write_pos;
+                }
+                if (start >= size) {
+                    return 0;
+                }
+            }
+            else if (start - write_pos >= size) {
+                return write_pos;
+            }
+
+            drop_oldest();
+        }
+    }
+
+    void RewindBuffer::push(const MachineState& state) noexcept {
+        if (!enabled()) {
+            return;
+        }
+        if (!has_head) {
+            head     = state;
+            has_head = true;
+            return;
+        }
+
+        auto size = encode_delta(head, state, scratch.data());
+
+        if (size > bytes.size()) {
+            // doesn't fit even on its own, history starts over from here
+            clear();
+            head     = state;
+            has_head = true;
+            return;
+        }
+
+        if (count == entries.size()) {
+            drop_oldest();
+        }
+
+        auto offset = make_room(size);
+        std::memcpy(bytes.data() + offset, scratch.data(), size);
+
+        count++;
+        newest()  = { offset, size };
+        write_pos = offset + size;
+        used += size;
+
+        head = state;
+    }
+
+    bool RewindBuffer::pop(MachineState& out) noexcept {
+        if (count == 0) {
+            return false;
+        }
+
+        auto e = newest();
+        if (!apply_delta(head, bytes.data() + e.offset, e.size)) {
+            // can't happen with our own deltas, but don't hand out a damaged state
+            clear();
+            return false;
+        }
+
+        count--;
+        used -= e.size;
+        write_pos = count == 0 ? 0 : newest().offset + newest().size;
+
+        out = head;
+        return true;
+    }
+
+    size_t RewindBuffer::frames() const noexcept { return count; }
+
+    size_t RewindBuffer::bytes_used() const noexcept { return used; }
+} // namespace core
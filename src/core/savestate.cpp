@@ -0,0 +1,72 @@
+#include "core/savestate.hpp"
+#include <bit>
+#include <cstring>
+#include <fstream>
+
+namespace core {
+
+    uint64_t state_checksum(const MachineState& state) noexcept {
+        // FNV-1a a word at a time, with a rotate so high bits feed back into low ones.
+        // catches truncated or damaged files, it's not meant to stop anyone
+        static_assert(sizeof(MachineState) % sizeof(uint64_t) == 0);
+
+        constexpr uint64_t prime = 0x100000001b3ULL;
+
+        auto bytes = reinterpret_cast<const unsigned char*>(&state);
+
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (size_t i = 0; i < sizeof(MachineState); i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, sizeof(word));
+
+            hash = std::rotl((hash ^ word) * prime, 29);
+        }
+        return hash;
+    }
+
+    void seal(SaveState& save) noexcept {
+        auto entry = save.header.entry_point;
+        auto base  = save.header.base_address;
+
+        save.header              = {};
+        save.header.entry_point  = entry;
+        save.header.base_address = base;
+        save.header.checksum     = state_checksum(save.state);
+    }
+
+    bool is_valid(const SaveState& save) noexcept {
+        const SaveStateHeader expected;
+
+        return save.header.magic == expected.magic && save.header.version == expected.version &&
+               save.header.size == expected.size &&
+               save.header.checksum == state_checksum(save.state);
+    }
+
+    bool write_save_state(const std::string& path, const SaveState& save) {
+        std::ofstream file(path, std::ios_base::binary | std::ios_base::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&save), sizeof(save));
+        file.close();
+
+        return !file.fail();
+    }
+
+    bool read_save_state(const std::string& path, SaveState& save) {
+        std::ifstream file(path, std::ios_base::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        // read into a scratch copy, so a bad file leaves save alone
+        SaveState loaded;
+        file.read(reinterpret_cast<char*>(&loaded), sizeof(loaded));
+        if (file.gcount() != static_cast<std::streamsize>(sizeof(loaded)) || !is_valid(loaded)) {
+            return false;
+        }
+
+        save = loaded;
+        return true;
+    }
+} // namespace core
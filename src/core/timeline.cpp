@@ -0,0 +1,60 @@
+#include "core/timeline.hpp"
+
+namespace core {
+
+    Timeline::Timeline() : checkpoints(capacity) {}
+
+    void Timeline::clear() noexcept {
+        first = 0;
+        count = 0;
+        key_log.clear();
+    }
+
+    void Timeline::truncate(size_t cycle) noexcept {
+        while (count > 0 && checkpoints[(first + count - 1) % capacity].cycle_count > cycle) {
+            count--;
+        }
+        while (!key_log.empty() && key_log.back().cycle > cycle) {
+            key_log.pop_back();
+        }
+    }
+
+    bool Timeline::due(size_t cycle) const noexcept {
+        return count == 0 ||
+               cycle >= checkpoints[(first + count - 1) % capacity].cycle_count + interval;
+    }
+
+    void Timeline::add_checkpoint(const MachineState& state) noexcept {
+        if (count == capacity) {
+            first = (first + 1) % capacity;
+            count--;
+
+            // nothing can be replayed from before the oldest checkpoint any more
+            auto oldest = checkpoints[first].cycle_count;
+            while (!key_log.empty() && key_log.front().cycle < oldest) {
+                key_log.pop_front();
+            }
+        }
+
+        checkpoints[(first + count) % capacity] = state;
+        count++;
+    }
+
+    void Timeline::key_changed(size_t cycle, const std::array<bool, 16>& keys) {
+        if (count > 0) {
+            key_log.push_back({ cycle, keys });
+        }
+    }
+
+    const MachineState* Timeline::checkpoint_at(size_t cycle) const noexcept {
+        for (size_t i = count; i > 0; --i) {
+            auto& c = checkpoints[(first + i - 1) % capacity];
+            if (c.cycle_count <= cycle) {
+                return &c;
+            }
+        }
+        return nullptr;
+    }
+
+    const std::deque<KeyChange>& Timeline::keys() const noexcept { return key_log; }
+} // namespace core
@@ -0,0 +1,129 @@
+#include "gui/beeper.hpp"
+#include <cmath>
+
+namespace GUI {
+
+    namespace {
+        constexpr int   FREQUENCY = 48000;
+        constexpr int   SAMPLES   = 512;
+        constexpr float TONE      = 440.0f;
+        constexpr float VOLUME    = 0.1f;
+
+        // how far behind the emulator we play, in frames, and how far we may fall behind
+        // before skipping ahead
+        constexpr double LATENCY_FRAMES = 2.0;
+        constexpr double MAX_LAG        = 8.0;
+
+        // fraction of the way to the target amplitude per sample, ~1ms to switch
+        constexpr float RAMP = 0.02f;
+    } // namespace
+
+    Beeper::Beeper(core::EmuWrapper& e) : emu(e) {}
+
+    Beeper::~Beeper() { close(); }
+
+    bool Beeper::open() {
+        SDL_AudioSpec want = {};
+        SDL_AudioSpec have = {};
+
+        want.freq     = FREQUENCY;
+        want.format   = AUDIO_F32SYS;
+        want.channels = 1;
+        want.samples  = SAMPLES;
+        want.callback = callback;
+        want.userdata = this;
+
+        device = SDL_OpenAudioDevice(nullptr, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+        if (device == 0) {
+            return false;
+        }
+        sample_rate = have.freq;
+
+        SDL_PauseAudioDevice(device, 0);
+        return true;
+    }
+
+    void Beeper::close() {
+        if (device != 0) {
+            SDL_CloseAudioDevice(device);
+            device = 0;
+        }
+    }
+
+    void Beeper::callback(void* userdata, Uint8* stream, int len) {
+        static_cast<Beeper*>(userdata)->fill(reinterpret_cast<float*>(stream),
+                                             static_cast<size_t>(len) / sizeof(float));
+    }
+
+    void Beeper::fill(float* out, size_t count) noexcept {
+        auto cps     = emu.cycles_per_second();
+        auto latest  = emu.sound_horizon();
+        auto latency = cps * LATENCY_FRAMES / 60.0;
+
+        if (latest < horizon) {
+            // a rom was loaded, cycles start over. anything queued before that is stale
+            clock     = 0.0;
+            on        = false;
+            has_next  = false;
+            buffering = true;
+            while (auto e = emu.pop_sound_event()) {
+                if (e->cycle <= latest) {
+                    next     = *e;
+                    has_next = true;
+                    break;
+                }
+            }
+        }
+        horizon = latest;
+
+        auto target = static_cast<double>(horizon) - latency;
+        if (clock < target - latency * MAX_LAG) {
+            // we fell too far behind, e.g. after the window was dragged. skip ahead
+            clock = target;
+        }
+        if (buffering && clock <= target) {
+            buffering = false;
+        }
+
+        auto per_sample = cps / sample_rate;
+        auto step       = static_cast<double>(TONE) / sample_rate;
+
+        for (size_t i = 0; i < count; ++i) {
+            // never play past what the emulator has published, that's silence. this is
+            // also what pausing sounds like
+            if (clock >= static_cast<double>(horizon)) {
+                buffering = true;
+            }
+            bool starved = buffering;
+
+            if (!starved) {
+                for (;;) {
+                    if (!has_next) {
+                        if (auto e = emu.pop_sound_event()) {
+                            next     = *e;
+                            has_next = true;
+                        }
+                        else {
+                            break;
+                        }
+                    }
+                    if (static_cast<double>(next.cycle) > clock) {
+                        break;
+                    }
+                    on       = next.on;
+                    has_next = false;
+                }
+                clock += per_sample;
+            }
+
+            float target_amp = (on && !starved) ? VOLUME : 0.0f;
+            amplitude += (target_amp - amplitude) * RAMP;
+
+            out[i] = phase < 0.5 ? amplitude : -amplitude;
+            phase += step;
+            if (phase >= 1.0) {
+                phase -= 1.0;
+            }
+        }
+    }
+} // namespace GUI
@@ -8,19 +8,6 @@
 namespace {
 
     std::unordered_map<uint16_t, std::shared_ptr<core::basic_block>> done;
-
-    // check if `val` is an opcode that breaks a basic block
-    bool is_jump_or_ret(op val) {
-        static std::array<op, 11> jumps = { op::JP,    op::JP_V0, op::SE_I, op::SE_R, op::SNE_I,
-                                            op::SNE_R, op::SKP,   op::SKNP, op::RET,  op::UNKNOWN };
-
-        for (auto j : jumps) {
-            if (j == val) {
-                return true;
-            }
-        }
-        return false;
-    }
 } // namespace
 
 namespace GUI {
@@ -33,7 +20,7 @@ namespace GUI {
             found_instructions.emplace_back(i);
         }
 
-        if (e.is_ready()) {
+        if (e.snapshot().ready) {
             first_analysis();
         }
     }
@@ -44,6 +31,14 @@ namespace GUI {
         // widths for text in the table for centering
         static float width = ImGui::CalcTextSize("F").x;
 
+        const auto& snap = emu.snapshot();
+
+        // the pause button was pressed last frame, this snapshot has the PC it stopped on
+        if (follow_pc && snap.paused) {
+            queue_scroll(snap.PC, true);
+            follow_pc = false;
+        }
+
         ImGui::SetNextWindowSize({ 400, 500 }, ImGuiCond_FirstUseEver);
 
         ImGui::Begin("Disassembler", &window_state, ImGuiWindowFlags_NoScrollbar);
@@ -91,8 +86,8 @@ namespace GUI {
                         ImGui::TableNextColumn();
 
                         // PC icon
-                        if (emu.is_readable()) {
-                            if (emu.get_PC() == ins1.address) {
+                        if (snap.ready) {
+                            if (snap.PC == ins1.address) {
                                 ImGui::Image(global::icon_textures()[ARROW_RIGHT_PC],
                                              ImVec2(font_size, font_size));
                             }
@@ -131,7 +126,8 @@ namespace GUI {
                                                 fmt::format("Remove breakpoint at address 0x{0:03X}",
                                                             ins1.address)
                                                         .c_str())) {
-                                        emu.remove_breakpoint(ins1.address);
+                                        emu.send({ .type = core::Command::kind::remove_breakpoint,
+                                                   .addr = ins1.address });
                                         ImGui::CloseCurrentPopup();
                                     }
                                 }
@@ -140,7 +136,8 @@ namespace GUI {
                                                 fmt::format("Add breakpoint at address 0x{0:03X}",
                                                             ins1.address)
                                                         .c_str())) {
-                                        emu.set_breakpoint(ins1.address);
+                                        emu.send({ .type = core::Command::kind::set_breakpoint,
+                                                   .addr = ins1.address });
                                         ImGui::CloseCurrentPopup();
                                     }
                                 }
@@ -167,9 +164,9 @@ namespace GUI {
                 }
 
                 // debugger tells us when we've reached a PC we should scroll to
-                if (emu.reached_destination()) {
-                    emu.recv_destination();
-                    queue_scroll(emu.get_PC());
+                if (snap.reached_destination) {
+                    emu.wait_done(emu.send({ .type = core::Command::kind::clear_destination }));
+                    queue_scroll(snap.PC);
                 }
                 // save last_scroll_val in case we scroll next frame
                 last_scroll_val = ImGui::GetScrollY();
@@ -222,32 +219,54 @@ namespace GUI {
             ImGui::SameLine();
 
             if (ImGui::ImageButton(global::icon_textures()[PAUSE], ImVec2(font_size, font_size))) {
-                emu.pause();
-                queue_scroll(emu.get_PC(), true);
+                emu.send({ .type = core::Command::kind::pause });
+                follow_pc = true;
+            }
+            ImGui::SameLine();
+
+            // going backwards replays from the last checkpoint, only while paused
+            if (ImGui::ImageButton(global::icon_textures()[REVERSE_CONTINUE],
+                                   ImVec2(font_size, font_size)) &&
+                snap.can_reverse) {
+                emu.send({ .type = core::Command::kind::reverse_continue });
+                follow_pc = true;
+            }
+            ImGui::SameLine();
+
+            if (ImGui::ImageButton(global::icon_textures()[REVERSE_STEP],
+                                   ImVec2(font_size, font_size)) &&
+                snap.can_reverse) {
+                emu.send({ .type = core::Command::kind::reverse_step });
+                follow_pc = true;
             }
             ImGui::SameLine();
 
             if (ImGui::ImageButton(global::icon_textures()[STEP_OVER],
                                    ImVec2(font_size, font_size))) {
-                emu.step_over();
+                emu.send({ .type = core::Command::kind::step_over });
             }
 
             ImGui::SameLine();
             if (ImGui::ImageButton(global::icon_textures()[STEP_INTO],
                                    ImVec2(font_size, font_size))) {
-                emu.single_step();
+                emu.send({ .type = core::Command::kind::single_step });
             }
 
             ImGui::SameLine();
             if (ImGui::ImageButton(global::icon_textures()[STEP_OUT],
                                    ImVec2(font_size, font_size))) {
-                emu.step_out();
+                emu.send({ .type = core::Command::kind::step_out });
             }
 
             ImGui::SameLine();
             if (ImGui::ImageButton(global::icon_textures()[CONTINUE],
                                    ImVec2(font_size, font_size))) {
-                emu.continue_emu();
+                emu.send({ .type = core::Command::kind::continue_emu });
+            }
+
+            if (snap.waiting_for_key) {
+                ImGui::SameLine();
+                ImGui::TextUnformatted("waiting for key");
             }
         }
 
@@ -274,7 +293,7 @@ namespace GUI {
             }
             // start adding instructions to this basic block
             auto current_address = start_address;
-            auto current_opcode  = emu.fetch(current_address);
+            auto current_opcode  = emu.snapshot().fetch(current_address);
 
             // current instruction isnt a jump, add it to list for this block
             while (!is_jump_or_ret(decode(current_opcode))) {
@@ -300,7 +319,7 @@ namespace GUI {
                     // go to next instruction
                     current_address += ins.length;
                     curr->append(std::move(ins));
-                    current_opcode = emu.fetch(current_address);
+                    current_opcode = emu.snapshot().fetch(current_address);
                 }
                 else {
                     // we add a reference and end our block
@@ -395,13 +414,13 @@ namespace GUI {
     // note that indirect jumps or calls cannot be found in this manner
     void DisassemblyView::first_analysis() {
 
-        if (!emu.is_ready())
+        if (!emu.snapshot().ready)
             return;
 
         control_flow_graph.clear();
         done.clear();
 
-        rec_cfg(emu.get_entry(), 0);
+        rec_cfg(emu.snapshot().entry_point, 0);
 
         std::sort(control_flow_graph.begin(), control_flow_graph.end(),
                   [](std::shared_ptr<core::basic_block> lhs,
@@ -550,8 +569,10 @@ namespace GUI {
             queue_scroll(m.target_address, m.save_history);
         }
         else if (msg.act == gui_action::new_game) {
+            // the rom was loaded after this frame's snapshot was picked up
+            emu.update_snapshot();
             first_analysis();
-            queue_scroll(emu.get_entry(), true);
+            queue_scroll(emu.snapshot().entry_point, true);
         }
     }
 
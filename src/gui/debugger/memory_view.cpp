@@ -13,6 +13,8 @@ namespace GUI {
 
         static uint16_t jump = 0;
 
+        const auto& snap = emu.snapshot();
+
         auto byte_to_printable = [&](char s) {
             if (s >= 0x20 && s <= 0x7E) {
                 return s;
@@ -94,7 +96,16 @@ namespace GUI {
 
                         auto context_menu = [&](uint16_t addr, uint8_t v) {
                             ImGui::PushID(addr);
+
+                            // bytes written since the last snapshot are red, like registers
+                            bool changed = snap.memory_changed[addr];
+                            if (changed) {
+                                ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0F, 0.0F, 0.0F, 1.0F));
+                            }
                             ImGui::Selectable(fmt::format("{0:02X}", v).c_str());
+                            if (changed) {
+                                ImGui::PopStyleColor();
+                            }
 
                             if (ImGui::BeginPopupContextItem()) {
                                 if (ImGui::Selectable(
@@ -119,7 +130,7 @@ namespace GUI {
                             }
                             else {
                                 auto address = base + real_index;
-                                auto val     = emu.get_memory()[base + real_index];
+                                auto val     = snap.memory[address];
 
                                 context_menu(address, val);
 
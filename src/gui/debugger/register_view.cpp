@@ -11,16 +11,19 @@ namespace GUI {
 
         static const float pair_width = 4.5F * width;
 
+        // published by the emulation thread, so it's safe to show while the game runs
+        const auto& snap = emu.snapshot();
+
         auto draw_I = [&]() {
             ImGui::TableNextColumn();
             helpers::center_text("I");
 
-            if (emu.is_readable()) {
+            if (snap.ready) {
                 ImGui::SameLine();
                 ImGui::Selectable("###I", false, ImGuiSelectableFlags_SpanAllColumns);
 
                 if (ImGui::BeginPopupContextItem()) {
-                    uint16_t value = emu.get_I() & 0xFFF;
+                    uint16_t value = snap.I & 0xFFF;
                     if (ImGui::Selectable(
                                 fmt::format("View {0:03X} in disassembly", value).c_str())) {
                         message = GUIMessage{ gui_component::disassembly_view, gui_action::scroll,
@@ -37,8 +40,8 @@ namespace GUI {
 
                 ImGui::TableNextColumn();
 
-                helpers::colored_centered_text({ 255, 0, 0, 255 }, emu.I_change,
-                                               fmt ::format("{:03X}", emu.get_I()).c_str());
+                helpers::colored_centered_text({ 255, 0, 0, 255 }, snap.I_changed,
+                                               fmt ::format("{:03X}", snap.I).c_str());
             }
             else {
                 ImGui::TableNextColumn();
@@ -51,12 +54,12 @@ namespace GUI {
             ImGui::TableNextColumn();
             helpers::center_text("PC");
 
-            if (emu.is_readable()) {
+            if (snap.ready) {
                 ImGui::SameLine();
                 ImGui::Selectable("###PC", false, ImGuiSelectableFlags_SpanAllColumns);
 
                 if (ImGui::BeginPopupContextItem()) {
-                    uint16_t value = emu.get_PC() & 0xFFF;
+                    uint16_t value = snap.PC & 0xFFF;
                     if (ImGui::Selectable(
                                 fmt::format("View {0:03X} in disassembly", value).c_str())) {
                         message = GUIMessage{ gui_component::disassembly_view, gui_action::scroll,
@@ -67,8 +70,8 @@ namespace GUI {
                 }
 
                 ImGui::TableNextColumn();
-                helpers::colored_centered_text({ 255, 0, 0, 255 }, emu.PC_change,
-                                               fmt::format("{:03X}", emu.get_PC()).c_str());
+                helpers::colored_centered_text({ 255, 0, 0, 255 }, snap.PC_changed,
+                                               fmt::format("{:03X}", snap.PC).c_str());
             }
             else {
                 ImGui::TableNextColumn();
@@ -80,9 +83,9 @@ namespace GUI {
             ImGui::TableNextColumn();
             helpers::center_text("D");
             ImGui::TableNextColumn();
-            if (emu.is_readable()) {
-                helpers::colored_centered_text({ 255, 0, 0, 255 }, emu.dt_change,
-                                               fmt::format("{:02X}", emu.get_DT()).c_str());
+            if (snap.ready) {
+                helpers::colored_centered_text({ 255, 0, 0, 255 }, snap.dt_changed,
+                                               fmt::format("{:02X}", snap.delay_timer).c_str());
             }
             else {
                 helpers::disabled_centered_text("??");
@@ -94,9 +97,9 @@ namespace GUI {
             helpers::center_text("S");
             ImGui::TableNextColumn();
 
-            if (emu.is_readable()) {
-                helpers::colored_centered_text({ 255, 0, 0, 255 }, emu.st_change,
-                                               fmt::format("{:02X}", emu.get_ST()).c_str());
+            if (snap.ready) {
+                helpers::colored_centered_text({ 255, 0, 0, 255 }, snap.st_changed,
+                                               fmt::format("{:02X}", snap.sound_timer).c_str());
             }
             else {
                 helpers::disabled_centered_text("??");
@@ -134,10 +137,10 @@ namespace GUI {
                     helpers::center_text(fmt::format("V{:01x}", index).c_str());
                     ImGui::TableNextColumn();
 
-                    if (emu.is_readable()) {
+                    if (snap.ready) {
                         helpers::colored_centered_text(
-                                { 255, 0, 0, 255 }, emu.reg_changes[index],
-                                fmt::format("{:02X}", emu.get_V(index)).c_str());
+                                { 255, 0, 0, 255 }, snap.V_changed[index],
+                                fmt::format("{:02X}", snap.V[index]).c_str());
                     }
                     else {
                         helpers::disabled_centered_text("??");
@@ -13,13 +13,13 @@ namespace GUI {
         ImGui::Begin("Stack view", &window_state);
         {
             ImGui::BeginChild("stacks");
-            auto& stack = emu.get_stack();
-            if (emu.is_readable()) {
+            const auto& snap = emu.snapshot();
+            if (snap.ready) {
 
                 for (auto i = 15; i >= 0; --i) {
 
-                    if (static_cast<size_t>(i) < stack.size()) {
-                        helpers::center_text(fmt::format("{0:03X}", stack[i]).c_str());
+                    if (static_cast<size_t>(i) < snap.stack_size) {
+                        helpers::center_text(fmt::format("{0:03X}", snap.stack[i]).c_str());
                     }
                     else {
                         helpers::disabled_centered_text("???");
@@ -1,11 +1,163 @@
 #include "gui/game.hpp"
 #include "gui/imgui_helpers.hpp"
+#include "gui/pixels.hpp"
 #include "global.hpp"
+#include <algorithm>
+#include <cmath>
 
 namespace GUI {
 
     Game::Game(core::EmuWrapper& e) : GUIComponent(0, true), emu(e) {}
 
+    void Game::create_texture(SDL_Renderer* r, int scale) {
+        renderer      = r;
+        texture_scale = scale;
+
+        // ABGR8888 is imgui's ImU32 layout, so colours go straight in. nearest filtering
+        // keeps the pixels sharp when scaled up
+        SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ABGR8888,
+                                    SDL_TEXTUREACCESS_STREAMING, X_PIXELS * scale,
+                                    Y_PIXELS * scale);
+
+        uploaded_generation = ~0ULL;
+    }
+
+    void Game::destroy_texture() {
+        if (texture != nullptr) {
+            SDL_DestroyTexture(texture);
+            texture = nullptr;
+        }
+    }
+
+    void Game::update_texture(const core::Snapshot& snap, uint32_t on, uint32_t off) {
+        if (renderer == nullptr) {
+            return;
+        }
+
+        auto filter = global::upscaler();
+
+        if (upscale::factor(filter) != texture_scale) {
+            destroy_texture();
+            create_texture(renderer, upscale::factor(filter));
+        }
+        if (texture == nullptr) {
+            return;
+        }
+
+        if (global::persistence() > 0.0f) {
+            persist_texture(snap, on, off);
+            return;
+        }
+        if (!intensity.empty()) {
+            // persistence was just turned off, the texture still has faded pixels in it
+            intensity.clear();
+            fading              = false;
+            uploaded_generation = ~0ULL;
+        }
+
+        bool redo_all = on != uploaded_on || off != uploaded_off || filter != uploaded_filter;
+
+        if (snap.framebuffer_generation == uploaded_generation && !redo_all) {
+            return;
+        }
+
+        uploaded_filter = filter;
+
+        if (filter != upscale::filter::none) {
+            // every output line depends on the lines around it, so redo the whole screen
+            upscale::apply(filter, snap.framebuffer, scaled);
+
+            void* dest  = nullptr;
+            int   pitch = 0;
+
+            if (SDL_LockTexture(texture, nullptr, &dest, &pitch) == 0) {
+                pixels::expand(scaled.data(), Y_PIXELS * texture_scale, texture_scale, on, off,
+                               dest, static_cast<size_t>(pitch));
+                SDL_UnlockTexture(texture);
+            }
+
+            uploaded            = snap.framebuffer;
+            uploaded_generation = snap.framebuffer_generation;
+            uploaded_on         = on;
+            uploaded_off        = off;
+            return;
+        }
+
+        // one locked rectangle covering every row that differs from what was uploaded
+        int first = Y_PIXELS;
+        int last  = -1;
+        for (int y = 0; y < Y_PIXELS; ++y) {
+            if (redo_all || uploaded_generation == ~0ULL || snap.framebuffer[y] != uploaded[y]) {
+                first = std::min(first, y);
+                last  = y;
+            }
+        }
+
+        if (last >= first) {
+            SDL_Rect rect{ 0, first, X_PIXELS, last - first + 1 };
+            void*    dest  = nullptr;
+            int      pitch = 0;
+
+            if (SDL_LockTexture(texture, &rect, &dest, &pitch) == 0) {
+                pixels::expand(snap.framebuffer.data() + first, rect.h, 1, on, off, dest,
+                               static_cast<size_t>(pitch));
+                SDL_UnlockTexture(texture);
+            }
+        }
+
+        uploaded            = snap.framebuffer;
+        uploaded_generation = snap.framebuffer_generation;
+        uploaded_on         = on;
+        uploaded_off        = off;
+    }
+
+    void Game::persist_texture(const core::Snapshot& snap, uint32_t on, uint32_t off) {
+        auto filter = global::upscaler();
+        auto now    = std::chrono::steady_clock::now();
+
+        // the decay is per 60Hz frame, scale it to however long it's been since the last one
+        // we showed so it looks the same at any refresh rate
+        std::chrono::duration<float> elapsed = now - last_persist;
+        last_persist                         = now;
+
+        float kept = std::pow(global::persistence(), std::min(elapsed.count(), 1.0f) * 60.0f);
+        auto  keep = static_cast<uint32_t>(std::lround(kept * 256.0f));
+
+        // a few microseconds, not worth caching when the whole texture is redone anyway
+        upscale::apply(filter, snap.framebuffer, scaled);
+
+        size_t width  = static_cast<size_t>(X_PIXELS * texture_scale);
+        size_t height = static_cast<size_t>(Y_PIXELS * texture_scale);
+        if (intensity.size() != width * height) {
+            intensity.assign(width * height, 0);
+        }
+
+        if (palette[255] != on || palette[0] != off) {
+            palette = pixels::make_palette(on, off);
+        }
+
+        fading = pixels::persist(scaled.data(), height, static_cast<size_t>(texture_scale), keep,
+                                 intensity.data());
+
+        void* dest  = nullptr;
+        int   pitch = 0;
+
+        if (SDL_LockTexture(texture, nullptr, &dest, &pitch) == 0) {
+            pixels::colourise(intensity.data(), height, width, palette, dest,
+                              static_cast<size_t>(pitch));
+            SDL_UnlockTexture(texture);
+        }
+
+        uploaded            = snap.framebuffer;
+        uploaded_generation = snap.framebuffer_generation;
+        uploaded_on         = on;
+        uploaded_off        = off;
+        uploaded_filter     = filter;
+    }
+
+    bool Game::animating() const noexcept { return fading; }
+
     void Game::draw_window() {
         ImU32 white = ImColor(global::white_vec());
         ImU32 black = ImColor(global::black_vec());
@@ -40,8 +192,6 @@ namespace GUI {
             menu bar is where most functionality will be
         */
 
-        ImDrawList* draw_list = ImGui::GetWindowDrawList();
-
         ImVec2 vMin = ImGui::GetWindowContentRegionMin();
         ImVec2 vMax = ImGui::GetWindowContentRegionMax();
 
@@ -68,19 +218,12 @@ namespace GUI {
         vMin.x += x_offset;
         vMin.y += y_offset;
 
-        for (auto i = 0; i < Y_PIXELS; ++i) {
-            auto y = vMin.y + i * scale;
-            for (auto j = 0; j < X_PIXELS; ++j) {
-                auto x = vMin.x + j * scale;
-                if (emu.frame_buffer()[i][j]) {
-                    draw_list->AddRectFilled(ImVec2{ x, y }, ImVec2{ x + scale, y + scale }, white,
-                                             0.0f, ImDrawFlags_RoundCornersNone);
-                }
-                else {
-                    draw_list->AddRectFilled(ImVec2{ x, y }, ImVec2{ x + scale, y + scale }, black,
-                                             0.0f, ImDrawFlags_RoundCornersNone);
-                }
-            }
+        update_texture(emu.snapshot(), white, black);
+
+        if (texture != nullptr) {
+            // the whole screen is one textured quad
+            ImGui::SetCursorScreenPos(vMin);
+            ImGui::Image(texture, ImVec2{ X_PIXELS * scale, Y_PIXELS * scale });
         }
 
         ImGui::End();
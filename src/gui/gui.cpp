@@ -1,9 +1,9 @@
 #include "gui/gui.hpp"
 #include <imgui_impl_sdl.h>
 #include <imgui_impl_sdlrenderer.h>
-#include <chrono>
+#include <algorithm>
 #include <thread>
-#include <future>
+#include <fmt/format.h>
 #include "global.hpp"
 #include "roboto_medium.hpp"
 #include "gui/icons.hpp"
@@ -17,8 +17,8 @@
 
 namespace GUI {
 
-    Main::Main() : game_window(emu) {
-        SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_GAMECONTROLLER);
+    Main::Main() : beeper(emu), game_window(emu) {
+        SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER | SDL_INIT_GAMECONTROLLER);
 
         SDL_WindowFlags flags = (SDL_WindowFlags)(SDL_WINDOW_OPENGL | SDL_WINDOW_ALLOW_HIGHDPI |
                                                   SDL_WINDOW_RESIZABLE);
@@ -46,14 +46,29 @@ namespace GUI {
         // load icon textures, maybe put this in a method later
         global::icon_textures() = generate_icons(font_size, renderer);
 
+        game_window.create_texture(renderer);
+
+        // no pref path means states go in the working directory
+        if (auto path = SDL_GetPrefPath("chip8emu", "chip8emu")) {
+            state_dir = path;
+            SDL_free(path);
+        }
+
+        // no audio device just means no sound
+        beeper.open();
+
         style();
     }
 
     Main::~Main() {
+        beeper.close();
+
         ImGui_ImplSDLRenderer_Shutdown();
         ImGui_ImplSDL2_Shutdown();
         ImGui::DestroyContext();
 
+        game_window.destroy_texture();
+
         SDL_DestroyRenderer(renderer);
         SDL_DestroyWindow(window);
         SDL_Quit();
@@ -161,6 +176,35 @@ namespace GUI {
                 ImGui::EndMenu();
             }
 
+            if (ImGui::BeginMenu("States")) {
+                bool ready = emu.snapshot().ready;
+
+                for (auto i = 1; i <= slot_count; ++i) {
+                    auto shortcut = fmt::format("Shift+F{}", i);
+                    if (ImGui::MenuItem(fmt::format("Save slot {}", i).c_str(), shortcut.c_str(),
+                                        false, ready)) {
+                        save_request = i;
+                    }
+                }
+
+                ImGui::Separator();
+
+                for (auto i = 1; i <= slot_count; ++i) {
+                    auto shortcut = fmt::format("F{}", i);
+                    if (ImGui::MenuItem(fmt::format("Load slot {}", i).c_str(),
+                                        shortcut.c_str())) {
+                        load_request = i;
+                    }
+                }
+
+                if (emu.snapshot().state_failed) {
+                    ImGui::Separator();
+                    ImGui::TextDisabled("last save or load failed");
+                }
+
+                ImGui::EndMenu();
+            }
+
             if (ImGui::BeginMenu("Debugger")) {
 
                 if (ImGui::MenuItem("All windows")) {
@@ -270,7 +314,7 @@ namespace GUI {
         }
     }
 
-    void Main::draw() {
+    void Main::draw(bool locked) {
 
         ImGui_ImplSDLRenderer_NewFrame();
         ImGui_ImplSDL2_NewFrame(window);
@@ -284,14 +328,115 @@ namespace GUI {
         SDL_RenderClear(renderer);
 
         ImGui_ImplSDLRenderer_RenderDrawData(ImGui::GetDrawData());
+
+        // present blocks until vsync, which is plenty of time for the next frame to be ready
+        // when we come round again
+        if (locked) {
+            request_frames();
+        }
+
         SDL_RenderPresent(renderer);
     }
 
-    void Main::handle_input() {
+    std::string Main::slot_path(int slot) const {
+        return fmt::format("{}slot{}.c8s", state_dir, slot);
+    }
+
+    void Main::handle_slots() {
+        if (save_request != 0) {
+            emu.send({ .type = core::Command::kind::save_state, .path = slot_path(save_request) });
+            save_request = 0;
+        }
+
+        if (load_request != 0) {
+            auto path    = slot_path(load_request);
+            load_request = 0;
+
+            emu.wait_done(emu.send({ .type = core::Command::kind::load_state, .path = path }));
+
+            emu.update_snapshot();
+            if (emu.snapshot().state_failed) {
+                return;
+            }
+
+            // a state brings its own instructions per frame
+            sent_instructions                = static_cast<int>(emu.snapshot().cycles_per_tick);
+            global::instructions_per_frame() = sent_instructions;
+
+            // memory may be a different program altogether, the debugger windows start over
+            for (auto& w : windows) {
+                w->process_message(GUIMessage(gui_component::all, gui_action::new_game));
+            }
+        }
+    }
+
+    void Main::sync_settings() {
+        auto instructions = global::instructions_per_frame();
+        if (instructions != sent_instructions) {
+            emu.send({ .type  = core::Command::kind::cycles_per_frame,
+                       .count = static_cast<size_t>(instructions) });
+            sent_instructions = instructions;
+        }
+
+        auto run_ahead = global::run_ahead();
+        if (run_ahead != sent_run_ahead) {
+            emu.send({ .type  = core::Command::kind::run_ahead,
+                       .count = static_cast<size_t>(run_ahead) });
+            sent_run_ahead = run_ahead;
+        }
+
+        auto rewind = global::rewind_seconds();
+        if (rewind != sent_rewind) {
+            emu.send({ .type  = core::Command::kind::rewind_length,
+                       .count = static_cast<size_t>(rewind) });
+            sent_rewind = rewind;
+        }
+
+        // 0 if the display doesn't say
+        SDL_DisplayMode mode  = {};
+        auto            index = SDL_GetWindowDisplayIndex(window);
+        if (index < 0 || SDL_GetCurrentDisplayMode(index, &mode) != 0) {
+            mode.refresh_rate = 0;
+        }
+        refresh_rate = mode.refresh_rate;
+
+        // nothing is presented while minimised, so there's no vsync to follow
+        auto hidden = SDL_GetWindowFlags(window) & (SDL_WINDOW_MINIMIZED | SDL_WINDOW_HIDDEN);
+        bool synced = global::frame_sync() && refresh_rate > 0.0 && hidden == 0;
+
+        if (synced != display_synced) {
+            emu.send({ .type  = core::Command::kind::frame_sync,
+                       .value = static_cast<uint8_t>(synced) });
+            display_synced = synced;
+        }
+    }
+
+    void Main::request_frames() {
+        auto now    = std::chrono::steady_clock::now();
+        auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(1.0 / refresh_rate));
+
+        // some drivers don't wait for vsync even when asked to. don't let that run the game
+        // flat out
+        if (now - last_vsync < period / 2) {
+            std::this_thread::sleep_until(last_vsync + period);
+            now = std::chrono::steady_clock::now();
+        }
+        last_vsync = now;
+
+        emu.vsync(refresh_rate);
+    }
+
+    bool Main::handle_input(int timeout_ms) {
         // handle keys
         SDL_Event event;
 
-        while (SDL_PollEvent(&event) != 0) {
+        // sleep until the first event, the rest are already there
+        if (SDL_WaitEventTimeout(&event, timeout_ms) == 0) {
+            return false;
+        }
+
+        do {
             // check to see if each event is one of our keys
             ImGui_ImplSDL2_ProcessEvent(&event);
 
@@ -305,6 +450,12 @@ namespace GUI {
                 exit(0);
             }
 
+            // letting go of rewind always counts, even if imgui has taken the keyboard since
+            if (event.type == SDL_KEYUP && event.key.keysym.sym == SDLK_BACKSPACE &&
+                !global::keymap().translate_key(SDLK_BACKSPACE)) {
+                emu.send({ .type = core::Command::kind::rewind, .value = 0 });
+            }
+
             if (!io.WantCaptureKeyboard) {
                 auto input_key = event.key.keysym.sym;
 
@@ -312,44 +463,92 @@ namespace GUI {
 
                 if (mapping.has_value()) {
 
-                    if (event.type == SDL_KEYDOWN) {
-                        emu.get_keys()[*mapping] = true;
+                    // held keys repeat, but the emulator only cares that it's still down
+                    if (event.type == SDL_KEYDOWN && !event.key.repeat) {
+                        emu.set_key(*mapping, true);
                     }
                     else if (event.type == SDL_KEYUP) {
-                        emu.get_keys()[*mapping] = false;
+                        emu.set_key(*mapping, false);
+                    }
+                }
+                else if (event.type == SDL_KEYDOWN && !event.key.repeat &&
+                         input_key == SDLK_BACKSPACE) {
+                    // rewinds for as long as it's held
+                    emu.send({ .type = core::Command::kind::rewind, .value = 1 });
+                }
+                else if (event.type == SDL_KEYDOWN && !event.key.repeat &&
+                         input_key >= SDLK_F1 && input_key < SDLK_F1 + slot_count) {
+                    // F keys load a slot, with shift they save one
+                    auto slot = static_cast<int>(input_key - SDLK_F1) + 1;
+                    if (event.key.keysym.mod & KMOD_SHIFT) {
+                        save_request = slot;
+                    }
+                    else {
+                        load_request = slot;
                     }
                 }
             }
-        }
+        } while (SDL_PollEvent(&event) != 0);
+
+        return true;
     }
 
     void Main::run() {
 
-        using namespace std::chrono_literals;
+        // everything the GUI asks of the emulator arrives there through commands, and it
+        // sleeps whenever there's nothing to run
+        std::thread thread([this] {
+            while (emu.run_batch()) {}
+        });
 
-        std::promise<void> exit;
+        // what the screen showed when it was last drawn
+        uint64_t drawn_generation = ~0ULL;
+        uint64_t drawn_version    = ~0ULL;
 
-        std::future<void> signal = exit.get_future();
+        // imgui needs a few frames after input for popups, hovering etc to settle
+        int settle_frames = 0;
 
-        auto gfx_thread = [&](std::future<void> exit) {
-            while (exit.wait_for(std::chrono::nanoseconds(1)) == std::future_status::timeout) {
-                while (!emu.is_paused() && emu.is_ready()) {
-                    emu.cycle();
-                }
-                std::this_thread::sleep_for(100ms);
-                emu.reset_timer();
+        while (!done) {
+            handle_slots();
+            sync_settings();
+
+            // while a game runs or pixels fade, check for a new frame often. otherwise only
+            // input or a command we sent changes anything, so sleep longer
+            auto& last = emu.snapshot();
+            bool  idle = (!last.ready || last.paused || last.waiting_for_key) &&
+                        !game_window.animating();
+
+            // with frames locked to the display we present every refresh, and presenting is
+            // what paces the game. a program waiting on a key with its timers stopped has
+            // nothing to run however many frames it's given
+            bool stalled = last.waiting_for_key && last.delay_timer == 0 && last.sound_timer == 0;
+            bool locked  = display_synced && last.ready && !last.paused && !stalled;
+
+            if (handle_input(locked ? 0 : idle ? 50 : 2)) {
+                settle_frames = 3;
             }
-        };
 
-        std::thread thread(gfx_thread, std::move(signal));
+            // every window draws from the same snapshot this frame
+            emu.update_snapshot();
 
-        while (!done) {
-            draw();
-            handle_input();
+            auto& snap = emu.snapshot();
+
+            bool changed = snap.framebuffer_generation != drawn_generation ||
+                           (!windows.empty() && snap.version != drawn_version) ||
+                           game_window.animating();
+
+            if (!changed && settle_frames == 0 && !locked) {
+                continue;
+            }
+
+            draw(locked);
+
+            drawn_generation = snap.framebuffer_generation;
+            drawn_version    = snap.version;
+            settle_frames    = std::max(settle_frames - 1, 0);
         }
 
-        // set promise value, signal to gfx thread to end
-        exit.set_value();
+        emu.stop();
 
         thread.join();
     }
@@ -7,7 +7,7 @@
 using namespace GUI;
 
 namespace {
-    constexpr std::array<std::pair<icons, const char*>, 12> svg_pairs = {
+    constexpr std::array<std::pair<icons, const char*>, 14> svg_pairs = {
         { { PAUSE,
             "<svg width='{0}' height='{0}' viewBox='0 0 16 16' xmlns='http://www.w3.org/2000/svg' fill='white'><path d='M4.5 3H6v10H4.5V3zm7 0v10H10V3h1.5z'/></svg>" },
           { STEP_INTO,
@@ -31,7 +31,11 @@ namespace {
           { ARROW_RIGHT_INACTIVE,
             "<svg width='{0}' height='{0}' viewBox='0 0 16 16' xmlns='http://www.w3.org/2000/svg' fill='currentcolor'><path fill-rule='evenodd' clip-rule='evenodd' d='M9 13.887l5-5V8.18l-5-5-.707.707 4.146 4.147H2v1h10.44L8.292 13.18l.707.707z'/></svg>" },
           { ARROW_RIGHT_PC,
-            "<svg width='{0}' height='{0}' viewBox='0 0 16 16' xmlns='http://www.w3.org/2000/svg' fill='green'><path fill-rule='evenodd' clip-rule='evenodd' d='M9 13.887l5-5V8.18l-5-5-.707.707 4.146 4.147H2v1h10.44L8.292 13.18l.707.707z'/></svg>" } }
+            "<svg width='{0}' height='{0}' viewBox='0 0 16 16' xmlns='http://www.w3.org/2000/svg' fill='green'><path fill-rule='evenodd' clip-rule='evenodd' d='M9 13.887l5-5V8.18l-5-5-.707.707 4.146 4.147H2v1h10.44L8.292 13.18l.707.707z'/></svg>" },
+          { REVERSE_STEP,
+            "<svg width='{0}' height='{0}' viewBox='0 0 16 16' xmlns='http://www.w3.org/2000/svg' fill='white'><path transform='matrix(-1 0 0 1 16 0)' fill-rule='evenodd' clip-rule='evenodd' d='M14.25 5.75v-4h-1.5v2.542c-1.145-1.359-2.911-2.209-4.84-2.209-3.177 0-5.92 2.307-6.16 5.398l-.02.269h1.501l.022-.226c.212-2.195 2.202-3.94 4.656-3.94 1.736 0 3.244.875 4.05 2.166h-2.83v1.5h4.163l.962-.975V5.75h-.004zM8 14a2 2 0 1 0 0-4 2 2 0 0 0 0 4z'/></svg>" },
+          { REVERSE_CONTINUE,
+            "<svg width='{0}' height='{0}' viewBox='0 0 16 16' xmlns='http://www.w3.org/2000/svg' fill='white'><path transform='matrix(-1 0 0 1 16 0)' fill-rule='evenodd' clip-rule='evenodd' d='M2.5 2H4v12H2.5V2zm4.936.39L6.25 3v10l1.186.61 7-5V7.39l-7-5zM12.71 8l-4.96 3.543V4.457L12.71 8z'/></svg>" } }
     };
 }
 
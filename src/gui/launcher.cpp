@@ -49,11 +49,17 @@ namespace GUI {
 
         if (helpers::center_button("OK")) {
             // new game
-            emu.new_game(last_file_name, entry_setting, base_address, launch_paused);
+            core::Command load;
+            load.type   = core::Command::kind::load_rom;
+            load.path   = last_file_name;
+            load.entry  = entry_setting;
+            load.addr   = base_address;
+            load.paused = launch_paused;
 
-            if (launch_paused) {
-                emu.pause();
+            // the debugger windows analyse the rom as soon as they get the message
+            emu.wait_done(emu.send(std::move(load)));
 
+            if (launch_paused) {
                 message = GUIMessage(gui_component::all, gui_action::new_game);
             }
 
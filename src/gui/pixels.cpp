@@ -0,0 +1,120 @@
+#include "gui/pixels.hpp"
+
+#if GUI_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace GUI::pixels {
+
+    void expand_line(uint64_t line, uint32_t on, uint32_t off, uint32_t* out) noexcept {
+#if GUI_HAS_SSE2
+        // four pixels at a time: spread a byte of the line over four lanes, test one bit in
+        // each, then pick on or off per lane with the resulting mask
+        const __m128i on_v   = _mm_set1_epi32(static_cast<int>(on));
+        const __m128i off_v  = _mm_set1_epi32(static_cast<int>(off));
+        const __m128i high_v = _mm_setr_epi32(0x80, 0x40, 0x20, 0x10);
+        const __m128i low_v  = _mm_setr_epi32(0x08, 0x04, 0x02, 0x01);
+
+        for (int byte = 0; byte < X_PIXELS / 8; ++byte) {
+            auto    bits = static_cast<int>((line >> (56 - byte * 8)) & 0xFF);
+            __m128i v    = _mm_set1_epi32(bits);
+
+            __m128i high = _mm_cmpeq_epi32(_mm_and_si128(v, high_v), high_v);
+            __m128i low  = _mm_cmpeq_epi32(_mm_and_si128(v, low_v), low_v);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + byte * 8),
+                             _mm_or_si128(_mm_and_si128(high, on_v), _mm_andnot_si128(high, off_v)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + byte * 8 + 4),
+                             _mm_or_si128(_mm_and_si128(low, on_v), _mm_andnot_si128(low, off_v)));
+        }
+#else
+        for (int x = 0; x < X_PIXELS; ++x) {
+            out[x] = (line >> (X_PIXELS - 1 - x)) & 1 ? on : off;
+        }
+#endif
+    }
+
+    void expand(const uint64_t* lines, size_t count, size_t words, uint32_t on, uint32_t off,
+                void* out, size_t pitch) noexcept {
+        auto* row = static_cast<uint8_t*>(out);
+
+        for (size_t y = 0; y < count; ++y, row += pitch) {
+            for (size_t w = 0; w < words; ++w) {
+                expand_line(lines[y * words + w], on, off,
+                            reinterpret_cast<uint32_t*>(row) + w * X_PIXELS);
+            }
+        }
+    }
+
+    bool persist(const uint64_t* lines, size_t count, size_t words, uint32_t keep,
+                 uint8_t* intensity) noexcept {
+        bool fading = false;
+
+        for (size_t i = 0; i < count * words; ++i, intensity += X_PIXELS) {
+            uint64_t line = lines[i];
+#if GUI_HAS_SSE2
+            // sixteen pixels at a time: fade in 16 bit lanes, then max with 0xFF wherever
+            // the pixel is lit
+            const __m128i keep_v = _mm_set1_epi16(static_cast<short>(keep));
+            const __m128i zero   = _mm_setzero_si128();
+            const __m128i full   = _mm_set1_epi8(-1);
+            const __m128i bit_v  = _mm_setr_epi8(-128, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                                 -128, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+
+            for (int x = 0; x < X_PIXELS; x += 16) {
+                auto* p = reinterpret_cast<__m128i*>(intensity + x);
+
+                __m128i v  = _mm_loadu_si128(p);
+                __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), keep_v), 8);
+                __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), keep_v), 8);
+
+                auto    bits = line >> (48 - x);
+                __m128i b    = _mm_unpacklo_epi64(_mm_set1_epi8(static_cast<char>(bits >> 8)),
+                                                  _mm_set1_epi8(static_cast<char>(bits)));
+                __m128i lit  = _mm_cmpeq_epi8(_mm_and_si128(b, bit_v), bit_v);
+
+                __m128i r = _mm_max_epu8(_mm_packus_epi16(lo, hi), lit);
+                _mm_storeu_si128(p, r);
+
+                __m128i settled = _mm_or_si128(_mm_cmpeq_epi8(r, zero), _mm_cmpeq_epi8(r, full));
+                fading |= _mm_movemask_epi8(settled) != 0xFFFF;
+            }
+#else
+            for (int x = 0; x < X_PIXELS; ++x) {
+                uint32_t v   = (line >> (X_PIXELS - 1 - x)) & 1 ? 255 : (intensity[x] * keep) >> 8;
+                intensity[x] = static_cast<uint8_t>(v);
+                fading |= v != 0 && v != 255;
+            }
+#endif
+        }
+        return fading;
+    }
+
+    std::array<uint32_t, 256> make_palette(uint32_t on, uint32_t off) noexcept {
+        std::array<uint32_t, 256> palette = {};
+
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t colour = 0;
+            // each byte of the colour on its own, whatever order the channels are in
+            for (int shift = 0; shift < 32; shift += 8) {
+                uint32_t a = (off >> shift) & 0xFF;
+                uint32_t b = (on >> shift) & 0xFF;
+                colour |= ((a * (255 - i) + b * i + 127) / 255) << shift;
+            }
+            palette[i] = colour;
+        }
+        return palette;
+    }
+
+    void colourise(const uint8_t* intensity, size_t count, size_t width,
+                   const std::array<uint32_t, 256>& palette, void* out, size_t pitch) noexcept {
+        auto* row = static_cast<uint8_t*>(out);
+
+        for (size_t y = 0; y < count; ++y, row += pitch, intensity += width) {
+            auto* dest = reinterpret_cast<uint32_t*>(row);
+            for (size_t x = 0; x < width; ++x) {
+                dest[x] = palette[intensity[x]];
+            }
+        }
+    }
+} // namespace GUI::pixels
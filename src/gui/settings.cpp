@@ -18,6 +18,41 @@ namespace GUI {
 
         ImGui::Separator();
 
+        helpers::center_text("Display");
+
+        auto& upscaler = global::upscaler();
+        if (ImGui::BeginCombo("upscaling filter", upscale::name(upscaler))) {
+            for (auto f : upscale::all_filters) {
+                if (ImGui::Selectable(upscale::name(f), f == upscaler)) {
+                    upscaler = f;
+                }
+            }
+            ImGui::EndCombo();
+        }
+
+        // fading lit pixels out instead of turning them off hides XOR flicker
+        ImGui::SliderFloat("phosphor persistence", &global::persistence(), 0.0f, 0.95f, "%.2f");
+
+        ImGui::Separator();
+
+        helpers::center_text("Timing");
+
+        // the display's refresh drives emulation, smoother but tied to the monitor
+        ImGui::Checkbox("lock frames to display", &global::frame_sync());
+
+        ImGui::SliderInt("instructions per frame", &global::instructions_per_frame(), 1, 1000,
+                         "%d", ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp);
+
+        // hides a frame or two of input lag, at the cost of running those frames again
+        ImGui::SliderInt("run ahead frames", &global::run_ahead(), 0, 4, "%d",
+                         ImGuiSliderFlags_AlwaysClamp);
+
+        // hold backspace to go back, a minute is a few megabytes at most
+        ImGui::SliderInt("rewind seconds", &global::rewind_seconds(), 0, 120, "%d",
+                         ImGuiSliderFlags_AlwaysClamp);
+
+        ImGui::Separator();
+
         helpers::center_text("Controls");
 
         // table kind of overkill, since we have 1 row
@@ -74,7 +109,7 @@ namespace GUI {
                                         // https://wiki.libsdl.org/SDLKeycodeLookup
                                         else if ((keycode > 0x29 && keycode < 0x3a) ||
                                                  (keycode > 0x60 && keycode < 0x7b)) {
-                                            k.first = keycode;
+                                            global::keymap().change_key(k.first, keycode);
                                             ImGui::CloseCurrentPopup();
                                         }
                                         else {
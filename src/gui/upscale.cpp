@@ -0,0 +1,258 @@
+#include "gui/upscale.hpp"
+#include <array>
+#include <algorithm>
+
+namespace {
+    using core::Framebuffer;
+
+    // pixel (x + dx, y + dy) at the bit for pixel x, for every x in line y. off the edge of
+    // the screen is the edge pixel repeated
+    uint64_t neighbour(const Framebuffer& fb, int y, int dx, int dy) noexcept {
+        uint64_t line = fb[std::clamp(y + dy, 0, Y_PIXELS - 1)];
+
+        if (dx > 0) {
+            uint64_t edge = (line & 1) != 0 ? (1ULL << dx) - 1 : 0;
+            return (line << dx) | edge;
+        }
+        if (dx < 0) {
+            uint64_t edge = (line >> 63) != 0 ? ~(~0ULL >> -dx) : 0;
+            return (line >> -dx) | edge;
+        }
+        return line;
+    }
+
+    // bitwise a == b, and a select between two lines
+    constexpr uint64_t eq(uint64_t a, uint64_t b) noexcept { return ~(a ^ b); }
+    constexpr uint64_t ne(uint64_t a, uint64_t b) noexcept { return a ^ b; }
+    constexpr uint64_t pick(uint64_t mask, uint64_t a, uint64_t b) noexcept {
+        return (mask & a) | (~mask & b);
+    }
+
+    // bit i of a byte moved to bit i * k
+    constexpr std::array<uint32_t, 256> make_spread(int k) {
+        std::array<uint32_t, 256> table = {};
+        for (uint32_t b = 0; b < 256; ++b) {
+            for (int i = 0; i < 8; ++i) {
+                table[b] |= ((b >> i) & 1) << (i * k);
+            }
+        }
+        return table;
+    }
+
+    constexpr auto spread2 = make_spread(2);
+    constexpr auto spread3 = make_spread(3);
+
+    // or nbits of value into a stream of words at bit pos, counting from the top bit
+    void put_bits(uint64_t* out, int pos, uint64_t value, int nbits) noexcept {
+        int word = pos / 64;
+        int off  = pos % 64;
+
+        if (off + nbits <= 64) {
+            out[word] |= value << (64 - off - nbits);
+        }
+        else {
+            int spill = off + nbits - 64;
+            out[word] |= value >> spill;
+            out[word + 1] |= value << (64 - spill);
+        }
+    }
+
+    // k lines of k * 64 pixels from k * k lines of 64, parts[row * k + col] being the
+    // pixel each source pixel turns into at (col, row) of its k by k block
+    void interleave(const uint64_t* parts, int k, uint64_t* out) noexcept {
+        const auto& spread = k == 2 ? spread2 : spread3;
+
+        for (int row = 0; row < k; ++row) {
+            uint64_t* line = out + row * k;
+            std::fill_n(line, k, 0);
+
+            // a byte of source pixels at a time, most significant first
+            for (int byte = 0; byte < 8; ++byte) {
+                uint64_t chunk = 0;
+                for (int col = 0; col < k; ++col) {
+                    auto bits = (parts[row * k + col] >> (56 - byte * 8)) & 0xFF;
+                    chunk |= static_cast<uint64_t>(spread[bits]) << (k - 1 - col);
+                }
+                put_bits(line, byte * 8 * k, chunk, 8 * k);
+            }
+        }
+    }
+
+    void scale2x(const Framebuffer& fb, std::vector<uint64_t>& out) noexcept {
+        for (int y = 0; y < Y_PIXELS; ++y) {
+            //   A
+            // C P B
+            //   D
+            uint64_t P = fb[y];
+            uint64_t A = neighbour(fb, y, 0, -1);
+            uint64_t B = neighbour(fb, y, 1, 0);
+            uint64_t C = neighbour(fb, y, -1, 0);
+            uint64_t D = neighbour(fb, y, 0, 1);
+
+            uint64_t parts[4] = {
+                pick(eq(C, A) & ne(C, D) & ne(A, B), A, P),
+                pick(eq(A, B) & ne(A, C) & ne(B, D), B, P),
+                pick(eq(D, C) & ne(D, B) & ne(C, A), C, P),
+                pick(eq(B, D) & ne(B, A) & ne(D, C), D, P),
+            };
+            interleave(parts, 2, out.data() + y * 2 * 2);
+        }
+    }
+
+    void scale3x(const Framebuffer& fb, std::vector<uint64_t>& out) noexcept {
+        for (int y = 0; y < Y_PIXELS; ++y) {
+            // A B C
+            // D E F
+            // G H I
+            uint64_t A = neighbour(fb, y, -1, -1);
+            uint64_t B = neighbour(fb, y, 0, -1);
+            uint64_t C = neighbour(fb, y, 1, -1);
+            uint64_t D = neighbour(fb, y, -1, 0);
+            uint64_t E = fb[y];
+            uint64_t F = neighbour(fb, y, 1, 0);
+            uint64_t G = neighbour(fb, y, -1, 1);
+            uint64_t H = neighbour(fb, y, 0, 1);
+            uint64_t I = neighbour(fb, y, 1, 1);
+
+            uint64_t db = eq(D, B) & ne(B, F) & ne(D, H);
+            uint64_t bf = eq(B, F) & ne(B, D) & ne(F, H);
+            uint64_t dh = eq(D, H) & ne(D, B) & ne(H, F);
+            uint64_t hf = eq(H, F) & ne(D, H) & ne(B, F);
+
+            uint64_t parts[9] = {
+                pick(db, D, E),
+                pick((db & ne(E, C)) | (bf & ne(E, A)), B, E),
+                pick(bf, F, E),
+                pick((db & ne(E, G)) | (dh & ne(E, A)), D, E),
+                E,
+                pick((bf & ne(E, I)) | (hf & ne(E, C)), F, E),
+                pick(dh, D, E),
+                pick((dh & ne(E, I)) | (hf & ne(E, G)), H, E),
+                pick(hf, F, E),
+            };
+            interleave(parts, 3, out.data() + y * 3 * 3);
+        }
+    }
+
+    // three bit planes of the sum of four one bit lines
+    struct sum3 {
+        uint64_t b0, b1, b2;
+    };
+
+    constexpr sum3 add4(uint64_t a, uint64_t b, uint64_t c, uint64_t d) noexcept {
+        // two half adders, then add the two 2 bit results
+        uint64_t s0 = a ^ b, c0 = a & b;
+        uint64_t s1 = c ^ d, c1 = c & d;
+
+        uint64_t b0    = s0 ^ s1;
+        uint64_t carry = s0 & s1;
+        uint64_t t     = c0 ^ c1;
+        uint64_t b1    = t ^ carry;
+        uint64_t b2    = (c0 & c1) | (t & carry);
+
+        return { b0, b1, b2 };
+    }
+
+    // x < y + 4 * extra, bitwise, with x and y at most 4
+    constexpr uint64_t less(sum3 x, sum3 y, uint64_t extra) noexcept {
+        uint64_t lt = (~x.b2 & y.b2) | (eq(x.b2, y.b2) & ((~x.b1 & y.b1) |
+                                                          (eq(x.b1, y.b1) & ~x.b0 & y.b0)));
+        // 4 * extra lifts y to at least 4, above x unless x is 4 and y is 0
+        uint64_t x_is_4 = x.b2;
+        uint64_t y_is_0 = ~(y.b0 | y.b1 | y.b2);
+        return pick(extra, ~(x_is_4 & y_is_0), lt);
+    }
+
+    // the bottom right quarter of every pixel in line y, with the neighbourhood mirrored by
+    // sx and sy to get the other corners
+    uint64_t xbr_corner(const Framebuffer& fb, int y, int sx, int sy) noexcept {
+        auto at = [&](int dx, int dy) { return neighbour(fb, y, dx * sx, dy * sy); };
+
+        //    A1 B1 C1
+        // A0 A  B  C  C4
+        // D0 D  E  F  F4
+        // G0 G  H  I  I4
+        //    G5 H5 I5
+        uint64_t B  = at(0, -1);
+        uint64_t C  = at(1, -1);
+        uint64_t D  = at(-1, 0);
+        uint64_t E  = fb[y];
+        uint64_t F  = at(1, 0);
+        uint64_t G  = at(-1, 1);
+        uint64_t H  = at(0, 1);
+        uint64_t I  = at(1, 1);
+        uint64_t F4 = at(2, 0);
+        uint64_t I4 = at(2, 1);
+        uint64_t H5 = at(0, 2);
+        uint64_t I5 = at(1, 2);
+
+        // with two colours every difference is one bit, and since E differs from both F
+        // and H whenever this matters, |H-F| is always 0 there and drops out
+        auto d1 = add4(ne(E, C), ne(E, G), ne(I, F4), ne(I, H5));
+        auto d2 = add4(ne(H, D), ne(H, I5), ne(F, I4), ne(F, B));
+
+        uint64_t edge = less(d1, d2, ne(E, I)) & ne(E, F) & ne(E, H);
+
+        // F and H are the same colour here
+        return pick(edge, F, E);
+    }
+
+    void xbr(const Framebuffer& fb, std::vector<uint64_t>& out) noexcept {
+        for (int y = 0; y < Y_PIXELS; ++y) {
+            uint64_t parts[4] = {
+                xbr_corner(fb, y, -1, -1),
+                xbr_corner(fb, y, 1, -1),
+                xbr_corner(fb, y, -1, 1),
+                xbr_corner(fb, y, 1, 1),
+            };
+            interleave(parts, 2, out.data() + y * 2 * 2);
+        }
+    }
+} // namespace
+
+namespace GUI::upscale {
+
+    const char* name(filter f) noexcept {
+        switch (f) {
+        case filter::none: return "None";
+        case filter::scale2x: return "Scale2x (EPX)";
+        case filter::scale3x: return "Scale3x";
+        case filter::xbr: return "xBR (2x)";
+        }
+        return "";
+    }
+
+    int factor(filter f) noexcept {
+        switch (f) {
+        case filter::none: return 1;
+        case filter::scale2x: return 2;
+        case filter::scale3x: return 3;
+        case filter::xbr: return 2;
+        }
+        return 1;
+    }
+
+    void apply(filter f, const core::Framebuffer& fb, std::vector<uint64_t>& out) {
+        auto k = factor(f);
+        out.resize(static_cast<size_t>(Y_PIXELS * k * k));
+
+        switch (f) {
+        case filter::none: {
+            std::copy(fb.begin(), fb.end(), out.begin());
+            break;
+        }
+        case filter::scale2x: {
+            scale2x(fb, out);
+            break;
+        }
+        case filter::scale3x: {
+            scale3x(fb, out);
+            break;
+        }
+        case filter::xbr: {
+            xbr(fb, out);
+            break;
+        }
+        }
+    }
+} // namespace GUI::upscale
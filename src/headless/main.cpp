@@ -0,0 +1,261 @@
+#include "core/emuwrapper.hpp"
+#include <fmt/format.h>
+#include <chrono>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// headless runner, executes a rom with no window and no frame pacing, then dumps
+// the final state of the emulator
+
+namespace {
+
+    struct key_event {
+        size_t  frame;
+        uint8_t key;
+        bool    down;
+    };
+
+    struct options {
+        std::string rom;
+        std::string input_script;
+
+        uint16_t entry        = 0x200;
+        uint16_t base_address = 0x200;
+
+        size_t cycles = 600 * CYCLES_PER_FRAME;
+
+        std::optional<uint64_t> seed;
+
+        bool show_framebuffer = true;
+
+        core::backend dispatch = core::default_backend();
+    };
+
+    void usage() {
+        fmt::print("usage: chip8run <rom> [options]\n"
+                   "  --entry <hex>      entry point (default 200)\n"
+                   "  --base <hex>       address rom is loaded at (default 200)\n"
+                   "  --cycles <n>       number of instructions to run\n"
+                   "  --frames <n>       number of 60Hz frames to run, 10 instructions each "
+                   "(default 600)\n"
+                   "  --input <file>     input script, lines of `<frame> <key hex> <down|up>`\n"
+                   "  --backend <name>   dispatch backend: switch, table, threaded, block or jit\n"
+                   "  --seed <n>         seed for RND, so runs can be repeated (default random)\n"
+                   "  --no-framebuffer   don't print the final framebuffer\n");
+    }
+
+    bool parse_number(const std::string& s, size_t& out, int base) {
+        try {
+            size_t pos = 0;
+            out        = std::stoull(s, &pos, base);
+            return pos == s.size();
+        }
+        catch (...) {
+            return false;
+        }
+    }
+
+    bool parse_args(int argc, char** argv, options& opts) {
+        for (auto i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+
+            // every option but --no-framebuffer takes a value
+            auto next = [&](std::string& out) {
+                if (i + 1 >= argc) {
+                    fmt::print(stderr, "missing value for {}\n", arg);
+                    return false;
+                }
+                out = argv[++i];
+                return true;
+            };
+
+            std::string value;
+            size_t      number = 0;
+
+            if (arg == "--entry" || arg == "--base") {
+                if (!next(value) || !parse_number(value, number, 16) || number >= MAX_MEMORY) {
+                    fmt::print(stderr, "invalid address for {}\n", arg);
+                    return false;
+                }
+                (arg == "--entry" ? opts.entry : opts.base_address) = static_cast<uint16_t>(number);
+            }
+            else if (arg == "--cycles" || arg == "--frames") {
+                if (!next(value) || !parse_number(value, number, 10)) {
+                    fmt::print(stderr, "invalid count for {}\n", arg);
+                    return false;
+                }
+                opts.cycles = arg == "--cycles" ? number : number * CYCLES_PER_FRAME;
+            }
+            else if (arg == "--input") {
+                if (!next(opts.input_script)) {
+                    return false;
+                }
+            }
+            else if (arg == "--backend") {
+                if (!next(value)) {
+                    return false;
+                }
+                auto b = core::backend_from_name(value);
+                if (!b.has_value() || !core::backend_available(*b)) {
+                    fmt::print(stderr, "backend {} isn't available\n", value);
+                    return false;
+                }
+                opts.dispatch = *b;
+            }
+            else if (arg == "--seed") {
+                if (!next(value) || !parse_number(value, number, 10)) {
+                    fmt::print(stderr, "invalid seed\n");
+                    return false;
+                }
+                opts.seed = number;
+            }
+            else if (arg == "--no-framebuffer") {
+                opts.show_framebuffer = false;
+            }
+            else if (arg == "--help" || arg == "-h") {
+                return false;
+            }
+            else if (opts.rom.empty() && !arg.starts_with("--")) {
+                opts.rom = arg;
+            }
+            else {
+                fmt::print(stderr, "unknown argument {}\n", arg);
+                return false;
+            }
+        }
+        return !opts.rom.empty();
+    }
+
+    // fills events sorted by frame, returns false if the script is malformed
+    bool read_input_script(const std::string& name, std::vector<key_event>& events) {
+        std::ifstream file(name);
+        if (!file.is_open()) {
+            fmt::print(stderr, "couldn't open input script {}\n", name);
+            return false;
+        }
+
+        std::string line;
+        size_t      line_number = 0;
+
+        while (std::getline(file, line)) {
+            line_number++;
+
+            // allow comments and blank lines
+            line = line.substr(0, line.find('#'));
+            if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                continue;
+            }
+
+            std::istringstream ss(line);
+
+            size_t      frame = 0;
+            std::string key;
+            std::string state;
+
+            ss >> frame >> key >> state;
+
+            size_t k = 0;
+            if (ss.fail() || !parse_number(key, k, 16) || k > 0xF ||
+                (state != "down" && state != "up")) {
+                fmt::print(stderr, "{}:{}: expected `<frame> <key hex> <down|up>`\n", name,
+                           line_number);
+                return false;
+            }
+
+            events.push_back({ frame, static_cast<uint8_t>(k), state == "down" });
+        }
+
+        std::stable_sort(events.begin(), events.end(),
+                         [](const key_event& lhs, const key_event& rhs) {
+                             return lhs.frame < rhs.frame;
+                         });
+        return true;
+    }
+
+    void dump_state(core::EmuWrapper& emu, const options& opts) {
+        if (opts.show_framebuffer) {
+            auto& fb = emu.frame_buffer();
+            for (unsigned y = 0; y < Y_PIXELS; ++y) {
+                std::string row;
+                row.reserve(X_PIXELS);
+                for (unsigned x = 0; x < X_PIXELS; ++x) {
+                    row += core::pixel_at(fb, x, y) ? '#' : '.';
+                }
+                fmt::print("{}\n", row);
+            }
+            fmt::print("\n");
+        }
+
+        for (uint8_t i = 0; i < 16; ++i) {
+            fmt::print("V{:X}={:02X}{}", i, emu.get_V(i), i % 8 == 7 ? '\n' : ' ');
+        }
+
+        fmt::print("I={:03X} PC={:03X} DT={:02X} ST={:02X} SP={}\n", emu.get_I(), emu.get_PC(),
+                   emu.get_DT(), emu.get_ST(), emu.get_stack().size());
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    options opts;
+
+    if (!parse_args(argc, argv, opts)) {
+        usage();
+        return 1;
+    }
+
+    std::vector<key_event> events;
+    if (!opts.input_script.empty() && !read_input_script(opts.input_script, events)) {
+        return 1;
+    }
+
+    core::EmuWrapper emu;
+    emu.set_backend(opts.dispatch);
+    if (opts.seed) {
+        emu.seed(*opts.seed);
+    }
+
+    if (!emu.load_rom(opts.rom, opts.entry, opts.base_address)) {
+        fmt::print(stderr, "couldn't open rom {}\n", opts.rom);
+        return 1;
+    }
+
+    using clock = std::chrono::steady_clock;
+
+    auto start = clock::now();
+
+    // run frame by frame only while there are key events left to apply,
+    // then everything else in one go
+    auto   next_event = events.begin();
+    size_t remaining  = opts.cycles;
+
+    for (size_t frame = 0; next_event != events.end() && remaining > 0; ++frame) {
+        while (next_event != events.end() && next_event->frame == frame) {
+            emu.get_keys()[next_event->key] = next_event->down;
+            ++next_event;
+        }
+
+        remaining -= emu.run_for(std::min<size_t>(remaining, CYCLES_PER_FRAME));
+    }
+
+    emu.run_for(remaining);
+
+    std::chrono::duration<double> elapsed = clock::now() - start;
+
+    dump_state(emu, opts);
+
+    // cycles spent waiting for a key are skipped rather than run, leave them out of the rate
+    auto waited   = emu.get_waited_cycles();
+    auto executed = emu.get_cycle_count() - waited;
+
+    fmt::print("{} instructions in {:.3f}s, {:.0f} instructions/s\n", executed, elapsed.count(),
+               elapsed.count() > 0.0 ? executed / elapsed.count() : 0.0);
+    if (waited > 0) {
+        fmt::print("{} cycles skipped waiting for a key\n", waited);
+    }
+
+    return 0;
+}
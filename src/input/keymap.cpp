@@ -11,7 +11,7 @@ namespace {
 
 namespace input {
 
-    Keys::Keys() { data = default_keymap; };
+    Keys::Keys() { reset(); };
 
     Keys::~Keys() = default;
 
@@ -21,15 +21,45 @@ namespace input {
         for (auto& v : data) {
             if (v.first == from) {
                 v.first = to;
+                rebuild();
                 return true;
             }
         }
         return false;
     }
 
-    std::pair<SDL_Keycode, uint8_t>& Keys::operator[](size_t v) noexcept { return data[v]; }
+    const std::pair<SDL_Keycode, uint8_t>& Keys::operator[](size_t v) const noexcept {
+        return data[v];
+    }
+
+    std::optional<size_t> Keys::slot(SDL_Keycode k) noexcept {
+        if (k >= 0 && k < 128) {
+            return static_cast<size_t>(k);
+        }
+        if ((k & SDLK_SCANCODE_MASK) != 0 && (k & ~SDLK_SCANCODE_MASK) < SDL_NUM_SCANCODES) {
+            return 128 + static_cast<size_t>(k & ~SDLK_SCANCODE_MASK);
+        }
+        return std::nullopt;
+    }
+
+    void Keys::rebuild() noexcept {
+        lookup.fill(-1);
+        for (auto& [code, key] : data) {
+            if (auto s = slot(code)) {
+                lookup[*s] = static_cast<int8_t>(key);
+            }
+        }
+    }
 
     std::optional<uint8_t> Keys::translate_key(SDL_Keycode k) const noexcept {
+        if (auto s = slot(k)) {
+            if (lookup[*s] < 0) {
+                return std::nullopt;
+            }
+            return static_cast<uint8_t>(lookup[*s]);
+        }
+
+        // no slot for it, but it can still be bound
         for (auto& p : data) {
             if (p.first == k) {
                 return p.second;
@@ -38,14 +68,7 @@ namespace input {
         return std::nullopt;
     }
 
-    bool Keys::contains(SDL_Keycode k) const noexcept {
-        for (auto& v : data) {
-            if (k == v.first) {
-                return true;
-            }
-        }
-        return false;
-    }
+    bool Keys::contains(SDL_Keycode k) const noexcept { return translate_key(k).has_value(); }
 
     bool Keys::contains(uint8_t k) const noexcept {
         for (auto& v : data) {
@@ -58,7 +81,10 @@ namespace input {
 
     // this is actually safe, since graphics and keyboard events are processed
     // in same thread
-    void Keys::reset() noexcept { data = { default_keymap }; }
+    void Keys::reset() noexcept {
+        data = { default_keymap };
+        rebuild();
+    }
 
     size_t Keys::size() const noexcept { return data.size(); }
 